@@ -7,6 +7,8 @@
 #
 # Automatically uses Docker for cross-compilation if needed.
 # Set CROSS_PREFIX to skip Docker (e.g., for native ARM builds).
+# Set RT_CHECK=1 for a debug build that aborts with a backtrace when
+# process_block allocates, locks or blocks (NAM_RT_CHECK=log to only log).
 set -e
 
 SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
@@ -30,6 +32,7 @@ if [ -z "$CROSS_PREFIX" ] && [ ! -f "/.dockerenv" ]; then
     docker run --rm \
         -v "$REPO_ROOT:/build" \
         -u "$(id -u):$(id -g)" \
+        -e RT_CHECK="${RT_CHECK:-}" \
         -w /build \
         "$IMAGE_NAME" \
         ./scripts/build.sh
@@ -103,6 +106,14 @@ fi
 echo "Found NeuralAudio: $NA_LIB"
 echo "Found RTNeural: $RT_LIB"
 
+# Real-time safety checker build: interposers need -Bsymbolic so calls from
+# inside the plugin bind to them, and frame pointers for usable backtraces
+EXTRA_FLAGS=()
+if [ "$RT_CHECK" = "1" ]; then
+    echo "RT safety checker enabled"
+    EXTRA_FLAGS=(-DNAM_RT_CHECK -g -fno-omit-frame-pointer -rdynamic -Wl,-Bsymbolic -ldl)
+fi
+
 ${CROSS_PREFIX}g++ -Ofast -shared -fPIC \
     -std=c++20 \
     -march=armv8-a -mtune=cortex-a72 \
@@ -128,7 +139,8 @@ ${CROSS_PREFIX}g++ -Ofast -shared -fPIC \
     -Ideps/NeuralAudio/deps/NeuralAmpModelerCore \
     "$NA_LIB" \
     "$RT_LIB" \
-    -lm -lpthread
+    -lm -lpthread \
+    "${EXTRA_FLAGS[@]}"
 
 echo "Plugin compiled: build/nam.so"
 
@@ -5,8 +5,13 @@
  * .aidax neural-network guitar-amp models as a Signal Chain audio effect.
  *
  * Includes built-in cabinet impulse response (IR) convolution for amp-only
- * models. Loads mono WAV files from the cabs/ directory and convolves via
- * direct time-domain overlap-save (cab IRs are short, typically <4096 samples).
+ * models. Cab IRs are WAV files from the cabs/ directory (PCM 16/24/32 or
+ * float 32/64, plain or WAVE_FORMAT_EXTENSIBLE): mono, stereo, or
+ * true-stereo folded to stereo for the mono amp. Long IRs run through a
+ * uniform partitioned FFT convolution, short ones directly in the time
+ * domain, with the crossover timed on the running CPU. Two cabs can be
+ * blended, from a shared input spectrum, and a settled blend or EQ is
+ * rebuilt into a single IR in the background.
  *
  * Dependencies (all header-only / static, permissive licenses):
  *   NeuralAudio  - MIT      - Mike Oliphant
@@ -16,7 +21,8 @@
  *   nlohmann/json- MIT      - Niels Lohmann
  *
  * Audio: 44100 Hz, 128 frames/block, stereo interleaved int16 in-place.
- * NAM models are mono - we sum L+R to mono, process, write back to both.
+ * NAM models are mono - we sum L+R to mono and process; a mono cab writes
+ * the result back to both sides, a stereo cab renders left and right.
  */
 
 #include <cstdio>
@@ -29,10 +35,29 @@
 #include <string>
 #include <atomic>
 #include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#if !defined(__aarch64__) && defined(__SSE__)
+#include <xmmintrin.h>     /* MXCSR, for flush_denormals */
+#endif
+#ifdef NAM_RT_CHECK
+#include <dlfcn.h>
+#include <cstdarg>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <new>
+#endif
 
 /* NeuralAudio */
 #include "NeuralAudio/NeuralModel.h"
 
+/* nlohmann/json (bundled with NeuralAudio) - state save/restore only */
+#include <nlohmann/json.hpp>
+
 /* Move Anything API */
 extern "C" {
 #include "plugin_api_v1.h"
@@ -46,6 +71,88 @@ extern "C" {
 #define MAX_PATH_LEN 512
 #define FRAMES_PER_BLOCK 128
 #define MAX_IR_LEN 8192
+#define MIDI_QUEUE_SIZE 256  /* power of two */
+#define MAX_SLOTS 8
+#define MAX_RETIRED_RIGS 8
+#define CAB_HIST_LEN (MAX_IR_LEN + FRAMES_PER_BLOCK)
+
+/* Partitioned FFT convolution: partitions are one block long */
+#define CONV_BLOCK FRAMES_PER_BLOCK
+#define CONV_FFT (2 * CONV_BLOCK)
+#define CONV_HALF CONV_BLOCK
+#define CONV_BINS (CONV_BLOCK + 1)
+#define CONV_BINS_PAD 144                 /* CONV_BINS rounded up to a cache line */
+#define CONV_SPEC_LEN (2 * CONV_BINS_PAD) /* one spectrum: re[] then im[] */
+#define CONV_MAX_PARTS (MAX_IR_LEN / CONV_BLOCK)
+#define CONV_FFT_MIN_TAPS 128             /* FFT threshold until calibrated */
+#define CAB_REBUILD_DELAY_NS 100000000ull /* settled blend/EQ before rebuilding (100 ms) */
+#define CAB_FADE_LEN (4 * FRAMES_PER_BLOCK)  /* old -> new cab crossfade (~12 ms) */
+
+/* Cab EQ, baked into the IR: bass and treble shelves, a mid peak */
+#define EQ_MAX_DB 12.0f
+#define EQ_BASS_HZ 120.0
+#define EQ_MID_HZ 750.0
+#define EQ_MID_Q 0.8
+#define EQ_TREBLE_HZ 3000.0
+#define EQ_TAIL_LEN 1024      /* IR growth to hold the filters' ringing */
+
+/* Per-instance DSP arena, in floats, laid out in the order process_block
+ * walks it. Every region starts on a 64-byte cache line. */
+#define ARENA_ALIGN_FLOATS (64 / sizeof(float))
+#define ARENA_MONO_IN   0
+#define ARENA_MONO_OUT  (ARENA_MONO_IN + FRAMES_PER_BLOCK)
+#define ARENA_IN_GAIN   (ARENA_MONO_OUT + FRAMES_PER_BLOCK)
+#define ARENA_OUT_GAIN  (ARENA_IN_GAIN + FRAMES_PER_BLOCK)
+#define ARENA_LITE      (ARENA_OUT_GAIN + FRAMES_PER_BLOCK)
+#define ARENA_LITE_LEN  32       /* 2 * LITE_MAX_SECTIONS, rounded to a line */
+#define ARENA_OUT_R     (ARENA_LITE + ARENA_LITE_LEN)
+#define ARENA_FADE      (ARENA_OUT_R + FRAMES_PER_BLOCK)
+#define ARENA_CONV_IN   (ARENA_FADE + FRAMES_PER_BLOCK)
+#define ARENA_CONV_ACC  (ARENA_CONV_IN + CONV_FFT)
+#define ARENA_CONV_ACC2 (ARENA_CONV_ACC + CONV_SPEC_LEN)
+#define ARENA_CONV_OUT  (ARENA_CONV_ACC2 + CONV_SPEC_LEN)
+#define ARENA_CAB_HIST  (ARENA_CONV_OUT + CONV_FFT)
+#define ARENA_FDL       (ARENA_CAB_HIST + CAB_HIST_LEN)
+#define ARENA_LEN       (ARENA_FDL + CONV_MAX_PARTS * CONV_SPEC_LEN)
+static_assert(FRAMES_PER_BLOCK % ARENA_ALIGN_FLOATS == 0 && CONV_BINS_PAD % ARENA_ALIGN_FLOATS == 0,
+              "arena regions must stay line aligned");
+#define WARMUP_SAMPLES 4096
+#define LOAD_SLICE_BYTES (64 * 1024)            /* model file read per slice */
+#define LOAD_BYTES_PER_SEC (16 * 1024 * 1024)   /* prefetch bandwidth cap */
+#define WARMUP_BLOCKS_PER_SLICE 4               /* warm-up blocks between pauses */
+#define LOADER_THREADS 2
+#define LOADER_QUEUE_SIZE 64   /* power of two */
+#define CAB_BANK_DEFAULT_MB 16  /* memory for preloaded catalog cabs */
+#define RETIRE_QUEUE_SIZE 16   /* power of two */
+#define MAX_LOADER_CPUS 64
+#define AUDIO_CPU_SAMPLE_BLOCKS 4096  /* ~12 s between audio CPU checks */
+#define FAULT_SAMPLE_BLOCKS 256       /* ~0.75 s between page fault counts */
+#define WATCHDOG_MISSES 8             /* consecutive late blocks before safe mode */
+
+/* Watchdog safe modes, each cheaper than the last */
+enum {
+    SAFE_OFF = 0,
+    SAFE_CAB_ONLY,      /* model skipped, dry signal through the cab */
+    SAFE_DRY,           /* model and cab skipped */
+};
+
+/* Memory locking (chain config "lock_memory") */
+enum {
+    MEMLOCK_OFF = 0,
+    MEMLOCK_BUFFERS,    /* mlock the instance, IRs and cab history */
+    MEMLOCK_ALL,        /* also mlockall(MCL_CURRENT) after each model load */
+};
+
+/* Loader thread scheduling */
+enum {
+    LOADER_POLICY_IDLE = 0,   /* SCHED_IDLE - runs only when a core is free */
+    LOADER_POLICY_BATCH,      /* SCHED_BATCH, nice 10 */
+    LOADER_POLICY_NORMAL,     /* SCHED_OTHER, nice 0 */
+};
+
+/* slot_request values besides a slot number */
+#define SLOT_REQ_NONE   -2
+#define SLOT_REQ_MANUAL -1
 
 static const host_api_v1_t *g_host = nullptr;
 
@@ -57,9 +164,81 @@ static void plugin_log(const char *msg) {
 /* WAV reader - minimal parser for cab IR files                              */
 /* ======================================================================== */
 
-/* Read a mono float IR from a WAV file. Supports PCM16 and float32.
- * Returns number of samples read, or 0 on failure. */
-static int load_wav_ir(const char *path, float *out, int max_samples) {
+#define WAVE_FORMAT_PCM 1
+#define WAVE_FORMAT_IEEE_FLOAT 3
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+static bool wav_format_supported(uint16_t format, uint16_t bits) {
+    if (format == WAVE_FORMAT_PCM) return bits == 16 || bits == 24 || bits == 32;
+    if (format == WAVE_FORMAT_IEEE_FLOAT) return bits == 32 || bits == 64;
+    return false;
+}
+
+/* One sample of each supported format, from possibly unaligned bytes.
+ * memcpy keeps the loads legal and compiles to a plain load. */
+struct wav_pcm16 {
+    static constexpr int bytes = 2;
+    static float get(const uint8_t *p) { int16_t v; memcpy(&v, p, 2); return v * (1.0f / 32768.0f); }
+};
+struct wav_pcm24 {
+    static constexpr int bytes = 3;
+    /* Assemble in the top bytes, then shift down to sign extend */
+    static float get(const uint8_t *p) {
+        const int32_t v = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8;
+        return v * (1.0f / 8388608.0f);
+    }
+};
+struct wav_pcm32 {
+    static constexpr int bytes = 4;
+    static float get(const uint8_t *p) { int32_t v; memcpy(&v, p, 4); return v * (1.0f / 2147483648.0f); }
+};
+struct wav_float32 {
+    static constexpr int bytes = 4;
+    static float get(const uint8_t *p) { float v; memcpy(&v, p, 4); return v; }
+};
+struct wav_float64 {
+    static constexpr int bytes = 8;
+    static float get(const uint8_t *p) { double v; memcpy(&v, p, 8); return (float)v; }
+};
+
+/* Decode count samples of one channel, STRIDE bytes apart, to float. With
+ * the stride known at compile time the loads are contiguous (mono) or a
+ * fixed interleave, which the vectorizer handles; STRIDE 0 takes it at run
+ * time, for padded containers and unusual channel counts. */
+template <typename F, int STRIDE>
+static void decode_wav_loop(const uint8_t *src, size_t stride, int count, float *dst) {
+    const size_t step = STRIDE ? STRIDE : stride;
+    for (int i = 0; i < count; i++) dst[i] = F::get(src + i * step);
+}
+
+template <typename F>
+static void decode_wav_frames(const uint8_t *src, size_t stride, int count, float *dst) {
+    if (stride == F::bytes) decode_wav_loop<F, F::bytes>(src, stride, count, dst);
+    else if (stride == 2 * F::bytes) decode_wav_loop<F, 2 * F::bytes>(src, stride, count, dst);
+    else if (stride == 4 * F::bytes) decode_wav_loop<F, 4 * F::bytes>(src, stride, count, dst);
+    else decode_wav_loop<F, 0>(src, stride, count, dst);
+}
+
+/* Decode count samples of one channel, stride bytes apart, to float: one
+ * loop per format and common frame size (mono, stereo, true stereo) */
+static void decode_wav_channel(const uint8_t *src, size_t stride, int count, uint16_t format,
+                               uint16_t bits, float *dst) {
+    if (format == WAVE_FORMAT_PCM && bits == 16) decode_wav_frames<wav_pcm16>(src, stride, count, dst);
+    else if (format == WAVE_FORMAT_PCM && bits == 24) decode_wav_frames<wav_pcm24>(src, stride, count, dst);
+    else if (format == WAVE_FORMAT_PCM && bits == 32) decode_wav_frames<wav_pcm32>(src, stride, count, dst);
+    else if (bits == 32) decode_wav_frames<wav_float32>(src, stride, count, dst);
+    else decode_wav_frames<wav_float64>(src, stride, count, dst);
+}
+
+/* Read an IR from a WAV file into out_l/out_r. Supports PCM16/24/32 and
+ * float32/64, plain or WAVE_FORMAT_EXTENSIBLE. Mono files fill both sides
+ * alike; stereo files give the left and right IRs; 4-channel true-stereo
+ * files (LL, LR, RL, RR) are folded for a mono source, left = LL + RL and
+ * right = LR + RR. The sample data is read in one go and decoded a
+ * channel at a time. *channels is set to 1 for mono, else 2. Returns
+ * number of samples read, or 0 on failure. */
+static int load_wav_ir(const char *path, float *out_l, float *out_r, int max_samples,
+                       int *channels) {
     FILE *f = fopen(path, "rb");
     if (!f) return 0;
 
@@ -71,11 +250,11 @@ static int load_wav_ir(const char *path, float *out, int max_samples) {
     if (fread(&file_size, 4, 1, f) != 1) { fclose(f); return 0; }
     if (fread(wave_id, 1, 4, f) != 4 || memcmp(wave_id, "WAVE", 4) != 0) { fclose(f); return 0; }
 
-    uint16_t audio_format = 0, num_channels = 0, bits_per_sample = 0;
-    uint32_t sample_rate = 0, data_size = 0;
+    uint16_t audio_format = 0, num_channels = 0, bits_per_sample = 0, block_align = 0;
+    uint32_t data_size = 0;
     bool found_fmt = false, found_data = false;
 
-    /* Parse chunks */
+    /* Parse chunks (word aligned: odd sizes carry a pad byte) */
     while (!found_data) {
         char chunk_id[4];
         uint32_t chunk_size;
@@ -83,63 +262,69 @@ static int load_wav_ir(const char *path, float *out, int max_samples) {
         if (fread(&chunk_size, 4, 1, f) != 1) break;
 
         if (memcmp(chunk_id, "fmt ", 4) == 0) {
+            uint8_t fmt[40] = {};
             if (chunk_size < 16) { fclose(f); return 0; }
-            fread(&audio_format, 2, 1, f);
-            fread(&num_channels, 2, 1, f);
-            fread(&sample_rate, 4, 1, f);
-            uint32_t byte_rate; fread(&byte_rate, 4, 1, f);
-            uint16_t block_align; fread(&block_align, 2, 1, f);
-            fread(&bits_per_sample, 2, 1, f);
-            /* Skip any extra fmt bytes */
-            if (chunk_size > 16) fseek(f, chunk_size - 16, SEEK_CUR);
+            const uint32_t want = chunk_size < sizeof(fmt) ? chunk_size : sizeof(fmt);
+            if (fread(fmt, 1, want, f) != want) { fclose(f); return 0; }
+            memcpy(&audio_format, fmt, 2);
+            memcpy(&num_channels, fmt + 2, 2);
+            memcpy(&block_align, fmt + 12, 2);
+            memcpy(&bits_per_sample, fmt + 14, 2);
+            /* Extensible: the real format is the first two bytes of the
+             * SubFormat GUID; the container width stays bits_per_sample */
+            if (audio_format == WAVE_FORMAT_EXTENSIBLE) {
+                if (chunk_size < 40) { fclose(f); return 0; }
+                memcpy(&audio_format, fmt + 24, 2);
+            }
+            if (chunk_size + (chunk_size & 1) > want) fseek(f, chunk_size + (chunk_size & 1) - want, SEEK_CUR);
             found_fmt = true;
         } else if (memcmp(chunk_id, "data", 4) == 0) {
             data_size = chunk_size;
             found_data = true;
         } else {
-            fseek(f, chunk_size, SEEK_CUR);
+            fseek(f, chunk_size + (chunk_size & 1), SEEK_CUR);
         }
     }
 
-    if (!found_fmt || !found_data) { fclose(f); return 0; }
-    /* Accept PCM (1) or IEEE float (3) */
-    if (audio_format != 1 && audio_format != 3) { fclose(f); return 0; }
+    if (!found_fmt || !found_data || num_channels == 0 ||
+        !wav_format_supported(audio_format, bits_per_sample)) {
+        fclose(f);
+        return 0;
+    }
 
-    int bytes_per_sample = bits_per_sample / 8;
-    int total_samples = data_size / (bytes_per_sample * num_channels);
+    const int bytes_per_sample = bits_per_sample / 8;
+    const size_t frame_bytes = block_align >= bytes_per_sample * num_channels
+        ? block_align : (size_t)bytes_per_sample * num_channels;
+    int total_samples = (int)(data_size / frame_bytes);
     if (total_samples > max_samples) total_samples = max_samples;
 
-    int read_count = 0;
-    for (int i = 0; i < total_samples; i++) {
-        float sample = 0.0f;
-        if (audio_format == 1 && bits_per_sample == 16) {
-            int16_t s; fread(&s, 2, 1, f);
-            sample = s / 32768.0f;
-        } else if (audio_format == 1 && bits_per_sample == 24) {
-            uint8_t b[3]; fread(b, 1, 3, f);
-            int32_t s = (b[0] | (b[1] << 8) | (b[2] << 16));
-            if (s & 0x800000) s |= 0xFF000000; /* sign extend */
-            sample = s / 8388608.0f;
-        } else if (audio_format == 1 && bits_per_sample == 32) {
-            int32_t s; fread(&s, 4, 1, f);
-            sample = s / 2147483648.0f;
-        } else if (audio_format == 3 && bits_per_sample == 32) {
-            fread(&sample, 4, 1, f);
-        } else if (audio_format == 3 && bits_per_sample == 64) {
-            double d; fread(&d, 8, 1, f);
-            sample = (float)d;
-        } else {
-            fclose(f); return 0;
-        }
-        /* Skip extra channels */
-        if (num_channels > 1) {
-            fseek(f, bytes_per_sample * (num_channels - 1), SEEK_CUR);
-        }
-        out[read_count++] = sample;
-    }
-
+    /* One read for the whole data chunk (short files just come up short) */
+    uint8_t *data = (uint8_t *)malloc((size_t)total_samples * frame_bytes + 1);
+    if (!data) { fclose(f); return 0; }
+    const int read_count = (int)(fread(data, frame_bytes, (size_t)total_samples, f));
     fclose(f);
 
+    decode_wav_channel(data, frame_bytes, read_count, audio_format, bits_per_sample, out_l);
+    if (num_channels >= 2) {
+        decode_wav_channel(data + bytes_per_sample, frame_bytes, read_count, audio_format,
+                           bits_per_sample, out_r);
+    } else {
+        memcpy(out_r, out_l, (size_t)read_count * sizeof(float));
+    }
+    if (num_channels >= 4) {
+        float *tmp = (float *)malloc((size_t)read_count * sizeof(float) + 1);
+        if (!tmp) { free(data); return 0; }
+        decode_wav_channel(data + 2 * bytes_per_sample, frame_bytes, read_count, audio_format,
+                           bits_per_sample, tmp);
+        for (int i = 0; i < read_count; i++) out_l[i] += tmp[i];
+        decode_wav_channel(data + 3 * bytes_per_sample, frame_bytes, read_count, audio_format,
+                           bits_per_sample, tmp);
+        for (int i = 0; i < read_count; i++) out_r[i] += tmp[i];
+        free(tmp);
+    }
+    free(data);
+    *channels = num_channels >= 2 ? 2 : 1;
+
     char msg[MAX_PATH_LEN + 128];
     snprintf(msg, sizeof(msg), "NAM: loaded cab IR %s (%d samples, %d ch, %d bit, fmt %d)",
              path, read_count, num_channels, bits_per_sample, audio_format);
@@ -152,52 +337,519 @@ static int load_wav_ir(const char *path, float *out, int max_samples) {
 /* Instance                                                                  */
 /* ======================================================================== */
 
+/* Parameters the audio thread reads. Built by the control thread and handed
+ * over as a whole block (see publish_params / consume_params). */
+typedef struct {
+    float input_gain;    /* linear gain */
+    float output_gain;   /* linear gain */
+    bool cab_bypass;     /* true = skip convolution */
+    bool cab_lite;       /* true = fitted biquads instead of the full IR */
+    float cab_blend;     /* dual cab mix, 0 = first cab only */
+    uint16_t serial;       /* bumped on every publish */
+    uint16_t gain_serial;  /* bumped when input_gain or output_gain changes */
+} nam_params_t;
+
+/* Targets a MIDI CC can drive */
+enum {
+    MIDI_TARGET_NONE = 0,
+    MIDI_TARGET_INPUT,
+    MIDI_TARGET_OUTPUT,
+    MIDI_TARGET_COUNT
+};
+
+/* Lite cab: a biquad cascade fitted to the IR's magnitude response */
+#define LITE_MAX_SECTIONS 10    /* high-pass, low-pass and up to 8 peaks */
+
+typedef struct {
+    float b0, b1, b2, a1, a2;
+} biquad_t;
+
+typedef struct {
+    biquad_t sec[LITE_MAX_SECTIONS];
+    int sections;
+    float gain;          /* overall linear gain */
+    float error_db;      /* RMS magnitude error of the fit, < 0 = no fit */
+} lite_cab_t;
+
+/* Cab EQ settings, dB; all zero = flat */
+typedef struct {
+    float bass;
+    float mid;
+    float treble;
+} cab_eq_t;
+
+/* Compact storage for cab spectra (config "cab_fp16"): IEEE half
+ * precision, widened to float as the convolution reads it. Only built
+ * where the conversion is a hardware instruction (AArch64, x86 with F16C);
+ * elsewhere _Float16 would convert in software on every block, so half_t
+ * is plain float and the option is refused. */
+#if defined(__FLT16_MAX__) && (defined(__aarch64__) || defined(__ARM_FP16_FORMAT_IEEE) || defined(__F16C__))
+typedef _Float16 half_t;
+#define HAVE_HALF 1
+#else
+typedef float half_t;
+#define HAVE_HALF 0
+#endif
+#define HALF_BUF_FLOATS(n) (((n) * sizeof(half_t) + sizeof(float) - 1) / sizeof(float))
+
+/* Partition spectra of one IR, parts * CONV_SPEC_LEN values, in float or -
+ * for a cab stored compact - half precision. At most one of f, h is set. */
+typedef struct {
+    float *f;
+    half_t *h;
+} cab_spec_t;
+
+/* A loaded cabinet: the IR and everything derived from it on the loader
+ * thread. Immutable once built; freed off the audio thread with free_cab.
+ * A stereo cab has a left and a right IR; a dual cab blends two files, and
+ * ir, spec and lite are the premix at blend. */
+typedef struct {
+    int channels;        /* 1 = mono, 2 = stereo; [1] entries unused for mono */
+    float *ir[2];        /* MAX_IR_LEN samples each, page aligned */
+    int ir_len;          /* number of IR samples */
+    int parts;           /* FFT partitions, 0 = direct convolution only */
+    cab_spec_t spec[2];  /* partition spectra of ir */
+    cab_spec_t spec_a[2];  /* dual cab: spectra of the two files, else unset */
+    cab_spec_t spec_b[2];
+    float blend;         /* 0 = first file only, 1 = second only */
+    lite_cab_t lite;     /* mono: fitted to the average of left and right */
+    float half_error_db; /* fp16 spectra: error against float, 0 = float */
+    bool banked;         /* owned by the cab bank: free_cab leaves it alone */
+} nam_cab_t;
+
+/* A complete, ready-to-play rig: model + cab + levels. Built and warmed by
+ * the loader pool, then published into a slot and never modified again -
+ * replacing a slot publishes a new rig and retires the old one. */
 typedef struct {
+    NeuralAudio::NeuralModel *model;
+    nam_cab_t *cab;      /* nullptr = no cab */
+    float input_level;
+    float output_level;
+    float input_gain;
+    float output_gain;
+    bool cab_bypass;
+    char model_path[MAX_PATH_LEN];
+    char model_name[MAX_NAME_LEN];
+    char cab_path[MAX_PATH_LEN];
+    char cab_name[MAX_NAME_LEN];
+    char cab2_path[MAX_PATH_LEN]; /* "" = single cab */
+    char cab2_name[MAX_NAME_LEN];
+    float cab_blend;
+    cab_eq_t eq;
+} nam_rig_t;
+
+/* A change to the manual rig on its way to the audio thread. After the swap
+ * it carries the replaced model/IR back to be freed off the audio thread. */
+typedef struct {
+    bool has_model;
+    bool has_cab;
+    NeuralAudio::NeuralModel *model;
+    nam_cab_t *cab;      /* nullptr with has_cab = remove the cab */
+} nam_update_t;
+
+/* A background load: up to two jobs (model, cab) that run in parallel and
+ * are published together by whichever finishes last */
+struct nam_instance;
+typedef struct {
+    struct nam_instance *inst;
+    int slot;                     /* target slot, or -1 for the manual rig */
+    std::atomic<int> remaining;   /* jobs not finished yet */
+    bool want_model;
+    char model_path[MAX_PATH_LEN];
+    uint32_t model_gen;
+    NeuralAudio::NeuralModel *model;
+    bool want_cab;
+    char cab_path[MAX_PATH_LEN];  /* "" = no cab */
+    char cab2_path[MAX_PATH_LEN]; /* "" = single cab */
+    float cab_blend;
+    cab_eq_t eq;
+    uint32_t cab_gen;
+    nam_cab_t *cab;
+    nam_rig_t *rig;               /* slot loads: levels and names, filled in on finish */
+} load_txn_t;
+
+typedef struct {
+    load_txn_t *txn;
+    bool is_model;
+} load_job_t;
+
+/* A CC change queued by on_midi for the audio thread */
+typedef struct {
+    uint64_t time_ns;    /* CLOCK_MONOTONIC arrival time */
+    uint8_t target;      /* MIDI_TARGET_* */
+    float gain;          /* linear gain, already mapped from the CC value */
+} midi_event_t;
+
+/* Instance layout: the fields process_block touches every block come first,
+ * packed together; then the atomics shared between threads, grouped by the
+ * thread that writes them and each group on its own cache line so a loader
+ * or control-thread store never invalidates a line the audio thread is
+ * reading; the cold control state and the ~330 KB file catalogs come last. */
+#define CACHE_LINE 64
+
+typedef struct nam_instance {
+    /* ---- Audio thread, hot: read or written every block ---- */
+
+    /* Manual rig (replaced through pending_update) and playing slot rig */
+    NeuralAudio::NeuralModel *model;
+    nam_cab_t *cab;
+    float *cab_history;  /* circular input buffer for convolution, CAB_HIST_LEN (in arena) */
+    nam_rig_t *slot_rig; /* playing rig, nullptr = manual */
+
+    /* Audio buffers (avoid per-block allocation), all carved from one
+     * page-aligned arena together with cab_history - see ARENA_* */
+    float *mono_in;
+    float *mono_out;
+    float *in_gain;                    /* per-sample gain curves */
+    float *out_gain;
+    float *lite_state;                 /* lite cab biquad state, z1/z2 pairs */
+
+    /* Copy of the parameters, plus the gains reached at the end of the
+     * previous block (start points for the next ramp) and the gains being
+     * ramped towards (last set_param or MIDI CC, whichever is newer) */
+    nam_params_t live;
+    uint16_t live_serial;
+    uint16_t live_gain_serial;
+    float cur_input_gain;
+    float cur_output_gain;
+    float tgt_input_gain;
+    float tgt_output_gain;
+    int cab_hist_pos;                  /* write position in circular buffer */
+    bool cur_cab_bypass;
+    uint64_t last_block_ns;            /* start time of the previous block */
+
+    /* ---- Shared, written by the audio thread ---- */
+    alignas(CACHE_LINE) std::atomic<int> params_reading;  /* index being copied, or -1 */
+    std::atomic<int> active_slot;       /* -1 = manual */
+    std::atomic<nam_rig_t *> rig_in_use;
+    std::atomic<uint32_t> retire_head;
+    std::atomic<uint32_t> midi_tail;
+
+    /* Block timing and faults (get_param reads) */
+    std::atomic<uint32_t> stat_blocks;
+    std::atomic<uint32_t> stat_overruns;       /* blocks over the deadline */
+    std::atomic<uint32_t> stat_load_overruns;  /* ... while a load was running */
+    std::atomic<uint32_t> stat_max_block_ns;
+    std::atomic<uint32_t> stat_minor_faults;   /* page faults on the audio thread */
+    std::atomic<uint32_t> stat_major_faults;
+    long fault_base[2];                 /* thread's minor/major faults at the last sample */
+    bool fault_base_set;
+    std::atomic<int> audio_cpu;         /* last seen audio thread CPU, -1 = unknown */
+    uint32_t cost_ns;                   /* smoothed block cost */
+    int budget_share;                   /* index into g_budget.shares, -1 = none */
+
+    /* Watchdog: late blocks in a row, and the safe mode it fell back to.
+     * Cleared whenever a different model or rig starts playing. */
+    int wd_misses;
+    std::atomic<int> safe_mode;         /* SAFE_* */
+    std::atomic<uint32_t> safe_trips;   /* times safe mode was entered */
+
+    /* FFT convolver state (buffers in the arena), touched only with a cab on */
+    float *conv_in;                     /* last two input blocks */
+    float *conv_acc;                    /* spectrum accumulators */
+    float *conv_acc2;
+    float *conv_out;                    /* inverse transform */
+    float *fdl;                         /* input spectra, CONV_MAX_PARTS */
+    int fdl_pos;                        /* FDL slot of the newest input spectrum */
+
+    /* Cab being faded out after a change, rendered alongside the new one
+     * for CAB_FADE_LEN samples. It stays alive through the manual update
+     * that replaced it, or through fade_rig (reap_retired_rigs skips it). */
+    const nam_cab_t *fade_cab;
+    int fade_pos;                       /* samples of the fade done */
+    int fade_taps;                      /* tap cap fade_cab plays at */
+    int cab_taps;                       /* tap cap in effect */
+    nam_update_t *fade_update;
+    std::atomic<nam_rig_t *> fade_rig;
+    float *fade_buf;                    /* its output (in arena) */
+    std::atomic<uint32_t> stat_cab_fades;
+    std::atomic<uint32_t> stat_fade_max_ns;  /* slowest block during a fade */
+    float *out_r;                       /* right output of a stereo cab (in arena) */
+    const nam_cab_t *lite_cab;          /* cab whose fit lite_state holds, nullptr = none */
+
+    /* ---- Shared, written by the control thread, read every block ---- */
+
+    /* Published parameter block, double-buffered */
+    alignas(CACHE_LINE) nam_params_t params[2];
+    std::atomic<int> params_front;    /* index of the latest published block */
+
+    /* Rig slots. slots[] hold fully loaded rigs (control thread publishes,
+     * audio thread reads). A switch is requested through slot_request and
+     * performed by process_block swapping slot_rig; rig_in_use mirrors it so
+     * the control thread knows when a replaced rig can be freed. */
+    alignas(CACHE_LINE) std::atomic<nam_rig_t *> slots[MAX_SLOTS];
+    std::atomic<int> slot_request;      /* SLOT_REQ_*, or slot number */
+
+    /* Manual rig updates: loader -> audio thread (exchanged by both) */
+    alignas(CACHE_LINE) std::atomic<nam_update_t *> pending_update;
+
+    /* ---- MIDI: written by on_midi ---- */
+
+    /* cc_map[cc] = MIDI_TARGET_*, written by set_param and read by on_midi.
+     * Events go through a single-producer/single-consumer ring to
+     * process_block, which places them by arrival time. */
+    alignas(CACHE_LINE) std::atomic<uint32_t> midi_head;
+    midi_event_t midi_queue[MIDI_QUEUE_SIZE];
+    std::atomic<uint8_t> cc_map[128];
+
+    /* ---- Loader threads and cold control state ---- */
+
+    /* Background loader pool */
+    alignas(CACHE_LINE) pthread_t loader_threads[LOADER_THREADS];
+    int loader_thread_count;
+    pthread_mutex_t loader_lock;
+    pthread_cond_t loader_cond;
+    load_job_t loader_queue[LOADER_QUEUE_SIZE];
+    uint32_t loader_head;
+    uint32_t loader_tail;
+    bool loader_quit;
+    load_txn_t *rebuild_txn;            /* settled blend/EQ cab load, run at rebuild_due_ns */
+    uint64_t rebuild_due_ns;
+    std::atomic<int> model_loads;       /* manual model loads in flight */
+    std::atomic<int> slot_loads;        /* slot loads in flight */
+    std::atomic<uint32_t> model_gen;    /* latest manual model request */
+    std::atomic<uint32_t> cab_gen;      /* latest manual cab request, bumped under loader_lock */
+    std::atomic<int> loader_busy;       /* jobs running right now */
+
+    /* Loader scheduling: policy and CPU mask (0 = auto, every core but the
+     * audio thread's). Workers re-apply when sched_gen changes. */
+    std::atomic<int> loader_policy;
+    std::atomic<uint64_t> loader_cpu_mask;
+    std::atomic<uint32_t> loader_sched_gen;
+    int lock_memory;                    /* MEMLOCK_*, fixed at creation */
+    bool cab_half;                      /* cab spectra in fp16, fixed at creation */
+
+    /* Cab bank, shared with other instances on the same catalog (see
+     * cab_bank_t); set once by start_cab_bank, nullptr = none */
+    struct cab_bank *bank;
+    size_t bank_budget;                 /* bytes for a bank this instance creates, 0 = no bank */
+
+    /* Returned updates, freed by the reaper */
+    nam_update_t *retire_queue[RETIRE_QUEUE_SIZE];
+    std::atomic<uint32_t> retire_tail;  /* written by the reaper */
+
+    /* Slot bookkeeping (control thread) */
+    std::atomic<int> deferred_slot;     /* slot to activate once loaded, -1 = none */
+    pthread_mutex_t publish_lock;       /* guards publishing and reclamation */
+    nam_rig_t *retired_rigs[MAX_RETIRED_RIGS];
+    int seen_slot;                      /* control thread: last active_slot synced */
+
+    /* Parameters (control thread) */
+    float input_level;   /* 0.0 - 1.0 knob position */
+    float output_level;  /* 0.0 - 1.0 knob position */
+    bool cab_bypass;     /* true = skip convolution */
+    bool cab_lite;       /* true = lite cab */
+    float cab_blend;     /* dual cab mix, 0.0 - 1.0 */
+    cab_eq_t eq;
+    uint16_t params_serial;
+    uint16_t params_gain_serial;
+    int target_cc[MIDI_TARGET_COUNT];  /* reverse map for get_param, -1 = off */
+
+    float *arena;                      /* owns mono_in ... cab_history */
+
     char module_dir[MAX_PATH_LEN];
 
     /* Model */
-    NeuralAudio::NeuralModel *model;
-    std::atomic<NeuralAudio::NeuralModel *> pending_model;  /* set by loader thread */
-    std::atomic<bool> loading;
     char model_path[MAX_PATH_LEN];
     char model_name[MAX_NAME_LEN];
+    int current_model_index;
+
+    /* Cabinet IR */
+    char cab_name[MAX_NAME_LEN];
+    int current_cab_index;
+    int current_cab2_index;            /* second cab to blend in, -1 = none */
+    std::atomic<float> cab_fit_error;  /* manual cab's lite fit error, -1 = no cab */
+    std::atomic<float> cab_half_error; /* ... and its fp16 spectra error, 0 = none */
 
     /* Scanned model files */
     int model_count;
     char model_names[MAX_MODELS][MAX_NAME_LEN];
     char model_paths[MAX_MODELS][MAX_PATH_LEN];
-    int current_model_index;
-
-    /* Cabinet IR */
-    float *cab_ir;       /* IR samples (heap allocated) */
-    int cab_ir_len;      /* number of IR samples */
-    float *cab_history;  /* circular input buffer for convolution */
-    int cab_hist_pos;    /* write position in circular buffer */
-    bool cab_bypass;     /* true = skip convolution */
-    char cab_name[MAX_NAME_LEN];
 
     /* Scanned cab files */
     int cab_count;
     char cab_names[MAX_CABS][MAX_NAME_LEN];
     char cab_paths[MAX_CABS][MAX_PATH_LEN];
-    int current_cab_index;
+} nam_instance_t;
 
-    /* Parameters */
-    float input_level;   /* 0.0 - 1.0 knob position */
-    float output_level;  /* 0.0 - 1.0 knob position */
-    float input_gain;    /* linear gain */
-    float output_gain;   /* linear gain */
+static_assert(offsetof(nam_instance_t, params_reading) <= 2 * CACHE_LINE,
+              "audio thread hot state should fit in two cache lines");
 
-    /* Audio buffers (avoid per-block allocation) */
-    float mono_in[FRAMES_PER_BLOCK];
-    float mono_out[FRAMES_PER_BLOCK];
+/* ======================================================================== */
+/* Real-time safety checker (build with -DNAM_RT_CHECK)                      */
+/* ======================================================================== */
 
-} nam_instance_t;
+/* Debug builds only: the plugin defines its own malloc/free, operator
+ * new/delete, pthread_mutex_lock and a few blocking calls, and reports any
+ * call made while the current thread is inside process_block. Link with
+ * -Wl,-Bsymbolic (scripts/build.sh does, with RT_CHECK=1) so calls from the
+ * plugin and the statically linked NeuralAudio bind to these definitions.
+ * A violation prints a backtrace to stderr and aborts, or only prints if
+ * NAM_RT_CHECK=log is set in the environment. */
+#ifdef NAM_RT_CHECK
+extern "C" {
+void *__libc_malloc(size_t);
+void *__libc_calloc(size_t, size_t);
+void *__libc_realloc(void *, size_t);
+void __libc_free(void *);
+void *__libc_memalign(size_t, size_t);
+}
+
+static thread_local int rt_depth;       /* > 0 inside process_block */
+static thread_local bool rt_reporting;  /* suppresses nested reports */
+
+struct rt_scope {
+    rt_scope() { rt_depth++; }
+    ~rt_scope() { rt_depth--; }
+};
+#define RT_CHECK_SCOPE() rt_scope rt_scope_guard
+
+static void rt_violation(const char *what) {
+    if (rt_depth == 0 || rt_reporting) return;
+    rt_reporting = true;
+    char msg[128];
+    int len = snprintf(msg, sizeof(msg), "NAM: RT violation in process_block: %s\n", what);
+    write(STDERR_FILENO, msg, (size_t)len);
+    void *frames[32];
+    int n = backtrace(frames, 32);
+    backtrace_symbols_fd(frames, n, STDERR_FILENO);
+    const char *mode = getenv("NAM_RT_CHECK");
+    rt_reporting = false;
+    if (!mode || strcmp(mode, "log") != 0) abort();
+}
+
+template <typename Fn>
+static Fn rt_next(const char *name) {
+    return (Fn)dlsym(RTLD_NEXT, name);
+}
+
+extern "C" {
+void *malloc(size_t size) { rt_violation("malloc"); return __libc_malloc(size); }
+void *calloc(size_t n, size_t size) { rt_violation("calloc"); return __libc_calloc(n, size); }
+void *realloc(void *p, size_t size) { rt_violation("realloc"); return __libc_realloc(p, size); }
+void free(void *p) { if (p) rt_violation("free"); __libc_free(p); }
+
+int posix_memalign(void **out, size_t align, size_t size) {
+    rt_violation("posix_memalign");
+    void *p = __libc_memalign(align, size);
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+int pthread_mutex_lock(pthread_mutex_t *m) {
+    static auto next = rt_next<int (*)(pthread_mutex_t *)>("pthread_mutex_lock");
+    rt_violation("pthread_mutex_lock");
+    return next(m);
+}
+
+int open(const char *path, int flags, ...) {
+    static auto next = rt_next<int (*)(const char *, int, ...)>("open");
+    rt_violation("open");
+    va_list ap;
+    va_start(ap, flags);
+    int mode = (flags & O_CREAT) ? va_arg(ap, int) : 0;
+    va_end(ap);
+    return next(path, flags, mode);
+}
+
+FILE *fopen(const char *path, const char *mode) {
+    static auto next = rt_next<FILE *(*)(const char *, const char *)>("fopen");
+    rt_violation("fopen");
+    return next(path, mode);
+}
+
+ssize_t read(int fd, void *buf, size_t count) {
+    static auto next = rt_next<ssize_t (*)(int, void *, size_t)>("read");
+    rt_violation("read");
+    return next(fd, buf, count);
+}
+
+int nanosleep(const struct timespec *req, struct timespec *rem) {
+    static auto next = rt_next<int (*)(const struct timespec *, struct timespec *)>("nanosleep");
+    rt_violation("nanosleep");
+    return next(req, rem);
+}
+
+int usleep(useconds_t usec) {
+    static auto next = rt_next<int (*)(useconds_t)>("usleep");
+    rt_violation("usleep");
+    return next(usec);
+}
+}
+
+void *operator new(size_t size) {
+    void *p = malloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+#else
+#define RT_CHECK_SCOPE() ((void)0)
+#endif
 
 /* ======================================================================== */
 /* Helpers                                                                   */
 /* ======================================================================== */
 
+/* Flush-to-zero for the duration of a scope. Decaying model state and IR
+ * tails otherwise drift into denormals, which cost tens to hundreds of
+ * cycles per operation on some ARM cores and on x86. The previous mode is
+ * restored on exit so the host thread is left as it was.
+ *   aarch64: FPCR.FZ (bit 24) and FPCR.DN (bit 25, default NaN)
+ *   x86:     MXCSR FTZ (bit 15) and DAZ (bit 6); there is no default-NaN */
+#if defined(__aarch64__)
+typedef uint64_t fp_mode_t;
+#define FP_FLUSH_BITS ((1ull << 24) | (1ull << 25))
+static inline fp_mode_t fp_mode_get(void) {
+    fp_mode_t v;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(v));
+    return v;
+}
+static inline void fp_mode_set(fp_mode_t v) {
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(v));
+}
+#elif defined(__SSE__)
+typedef unsigned int fp_mode_t;
+#define FP_FLUSH_BITS 0x8040u
+static inline fp_mode_t fp_mode_get(void) { return _mm_getcsr(); }
+static inline void fp_mode_set(fp_mode_t v) { _mm_setcsr(v); }
+#else
+typedef unsigned int fp_mode_t;
+#define FP_FLUSH_BITS 0u
+static inline fp_mode_t fp_mode_get(void) { return 0; }
+static inline void fp_mode_set(fp_mode_t) {}
+#endif
+
+struct flush_denormals {
+    fp_mode_t saved;
+    flush_denormals() : saved(fp_mode_get()) {
+        if ((saved & FP_FLUSH_BITS) != FP_FLUSH_BITS) fp_mode_set(saved | FP_FLUSH_BITS);
+    }
+    ~flush_denormals() {
+        if ((saved & FP_FLUSH_BITS) != FP_FLUSH_BITS) fp_mode_set(saved);
+    }
+};
+
+/* Watchdog: a new model or rig gets a fresh chance. Audio thread only. */
+static void watchdog_reset(nam_instance_t *inst) {
+    inst->wd_misses = 0;
+    inst->safe_mode.store(SAFE_OFF, std::memory_order_relaxed);
+}
+
+/* Watchdog: fall back one safe mode. Audio thread only. */
+static void watchdog_trip(nam_instance_t *inst) {
+    int mode = inst->safe_mode.load(std::memory_order_relaxed);
+    if (mode == SAFE_DRY) return;
+    inst->safe_mode.store(mode + 1, std::memory_order_relaxed);
+    inst->safe_trips.fetch_add(1, std::memory_order_relaxed);
+    inst->wd_misses = 0;
+}
+
 /* Map 0-1 knob to dB range (-24 to +12), then to linear gain */
 static float knob_to_gain(float knob) {
     float db = -24.0f + knob * 36.0f;  /* 0 -> -24dB, 0.5 -> -6dB, 1.0 -> +12dB */
@@ -208,6 +860,66 @@ static inline float clampf(float v, float lo, float hi) {
     return v < lo ? lo : (v > hi ? hi : v);
 }
 
+/* Publish the control-side parameters to the audio thread. Writes the block
+ * the audio thread is not looking at, then flips params_front. If the audio
+ * thread happens to be copying the target block (it only ever holds it for a
+ * few loads), wait for it to finish. Control thread only. */
+static void publish_params(nam_instance_t *inst) {
+    int back = 1 - inst->params_front.load(std::memory_order_relaxed);
+    while (inst->params_reading.load(std::memory_order_seq_cst) == back) {
+        /* spin - the reader holds a block for a handful of instructions */
+    }
+
+    /* Gains are compared with the front block, the last one published */
+    const nam_params_t *prev = &inst->params[1 - back];
+    nam_params_t *p = &inst->params[back];
+    p->input_gain = knob_to_gain(inst->input_level);
+    p->output_gain = knob_to_gain(inst->output_level);
+    if (p->input_gain != prev->input_gain || p->output_gain != prev->output_gain) {
+        ++inst->params_gain_serial;
+    }
+    p->gain_serial = inst->params_gain_serial;
+    p->cab_bypass = inst->cab_bypass;
+    p->cab_lite = inst->cab_lite;
+    p->cab_blend = inst->cab_blend;
+    p->serial = ++inst->params_serial;
+
+    inst->params_front.store(back, std::memory_order_seq_cst);
+}
+
+/* Take a snapshot of the latest published parameter block into inst->live.
+ * Called once at the top of each block. Audio thread only, never blocks. */
+static void consume_params(nam_instance_t *inst) {
+    for (int attempt = 0; attempt < 4; attempt++) {
+        int front = inst->params_front.load(std::memory_order_seq_cst);
+        inst->params_reading.store(front, std::memory_order_seq_cst);
+        /* Re-check: the writer may have flipped between our two stores */
+        if (inst->params_front.load(std::memory_order_seq_cst) == front) {
+            inst->live = inst->params[front];
+            inst->params_reading.store(-1, std::memory_order_release);
+            return;
+        }
+    }
+    /* Writer is publishing continuously - keep last block's values */
+    inst->params_reading.store(-1, std::memory_order_release);
+}
+
+static inline uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Fill dst[from..to) with a linear ramp that starts just after g_from and
+ * lands exactly on g_to at dst[to - 1]. */
+static inline void fill_ramp(float *dst, int from, int to, float g_from, float g_to) {
+    if (to <= from) return;
+    const float step = (g_to - g_from) / (float)(to - from);
+    for (int i = from; i < to; i++) {
+        dst[i] = g_from + step * (float)(i - from + 1);
+    }
+}
+
 /* Strip directory and extension from path to get display name */
 static void path_to_name(const char *path, char *name, int name_len) {
     const char *slash = strrchr(path, '/');
@@ -219,202 +931,2508 @@ static void path_to_name(const char *path, char *name, int name_len) {
     name[len] = '\0';
 }
 
-/* Check if filename ends with .nam or .json or .aidax */
-static bool is_model_file(const char *name) {
-    const char *dot = strrchr(name, '.');
-    if (!dot) return false;
-    return (strcasecmp(dot, ".nam") == 0 ||
-            strcasecmp(dot, ".json") == 0 ||
-            strcasecmp(dot, ".aidax") == 0);
+/* Check if filename ends with .nam or .json or .aidax */
+static bool is_model_file(const char *name) {
+    const char *dot = strrchr(name, '.');
+    if (!dot) return false;
+    return (strcasecmp(dot, ".nam") == 0 ||
+            strcasecmp(dot, ".json") == 0 ||
+            strcasecmp(dot, ".aidax") == 0);
+}
+
+/* Check if filename ends with .wav or .ir */
+static bool is_cab_file(const char *name) {
+    const char *dot = strrchr(name, '.');
+    if (!dot) return false;
+    return (strcasecmp(dot, ".wav") == 0 ||
+            strcasecmp(dot, ".ir") == 0);
+}
+
+/* Generic directory scanner - populates parallel name/path arrays.
+ * Returns file count. */
+static int scan_directory(const char *dir_path,
+                          char names[][MAX_NAME_LEN],
+                          char paths[][MAX_PATH_LEN],
+                          int max_entries,
+                          bool (*filter)(const char *)) {
+    int count = 0;
+    DIR *dir = opendir(dir_path);
+    if (!dir) return 0;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr && count < max_entries) {
+        if (entry->d_name[0] == '.') continue;
+        if (!filter(entry->d_name)) continue;
+
+        snprintf(paths[count], MAX_PATH_LEN, "%s/%s", dir_path, entry->d_name);
+        path_to_name(entry->d_name, names[count], MAX_NAME_LEN);
+        count++;
+    }
+    closedir(dir);
+
+    /* Sort alphabetically by name */
+    for (int i = 0; i < count - 1; i++) {
+        for (int j = i + 1; j < count; j++) {
+            if (strcasecmp(names[i], names[j]) > 0) {
+                char tmp_name[MAX_NAME_LEN], tmp_path[MAX_PATH_LEN];
+                memcpy(tmp_name, names[i], MAX_NAME_LEN);
+                memcpy(tmp_path, paths[i], MAX_PATH_LEN);
+                memcpy(names[i], names[j], MAX_NAME_LEN);
+                memcpy(paths[i], paths[j], MAX_PATH_LEN);
+                memcpy(names[j], tmp_name, MAX_NAME_LEN);
+                memcpy(paths[j], tmp_path, MAX_PATH_LEN);
+            }
+        }
+    }
+
+    return count;
+}
+
+/* Scan models directory and populate instance model list */
+static void scan_models(nam_instance_t *inst) {
+    char models_dir[MAX_PATH_LEN];
+    snprintf(models_dir, sizeof(models_dir), "%s/models", inst->module_dir);
+
+    inst->model_count = scan_directory(models_dir,
+                                       inst->model_names, inst->model_paths,
+                                       MAX_MODELS, is_model_file);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "NAM: found %d model files", inst->model_count);
+    plugin_log(msg);
+}
+
+/* Scan cabs directory and populate instance cab list */
+static void scan_cabs(nam_instance_t *inst) {
+    char cabs_dir[MAX_PATH_LEN];
+    snprintf(cabs_dir, sizeof(cabs_dir), "%s/cabs", inst->module_dir);
+
+    inst->cab_count = scan_directory(cabs_dir,
+                                     inst->cab_names, inst->cab_paths,
+                                     MAX_CABS, is_cab_file);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "NAM: found %d cab IR files", inst->cab_count);
+    plugin_log(msg);
+}
+
+/* DSP buffers the audio thread reads (IRs, the instance arena) are page aligned,
+ * so they can be locked without pinning a neighbour's pages, and written
+ * through once here so no first-touch fault lands in process_block. */
+static float *alloc_dsp_buffer(size_t count, int lock_memory) {
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t bytes = (count * sizeof(float) + page - 1) & ~(page - 1);
+    void *p = nullptr;
+    if (posix_memalign(&p, page, bytes) != 0) return nullptr;
+    memset(p, 0, bytes);
+    if (lock_memory != MEMLOCK_OFF && mlock(p, bytes) != 0) {
+        plugin_log("NAM: mlock failed, buffer left unlocked");
+    }
+    return (float *)p;
+}
+
+static void free_dsp_buffer(float *buf, size_t count) {
+    if (!buf) return;
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    munlock(buf, (count * sizeof(float) + page - 1) & ~(page - 1));
+    free(buf);
+}
+
+static void sleep_ns(uint64_t ns) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ns / 1000000000ull);
+    ts.tv_nsec = (long)(ns % 1000000000ull);
+    nanosleep(&ts, nullptr);
+}
+
+/* Model construction is split into bounded slices so a load never hits the
+ * memory system in one long burst while the audio thread is running:
+ *
+ *   1. prefetch  - the file is read into the page cache LOAD_SLICE_BYTES at
+ *                  a time, paced to LOAD_BYTES_PER_SEC
+ *   2. build     - CreateFromFile() parses, allocates and copies weights; it
+ *                  is a single NeuralAudio call, but reads from a warm cache
+ *   3. warm-up   - WARMUP_BLOCKS_PER_SLICE blocks at a time, each slice
+ *                  followed by an equally long pause (50% duty cycle)
+ *
+ * Loads take longer, in exchange for leaving bandwidth to the audio core. */
+static void prefetch_model_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return;
+    char *slice = (char *)malloc(LOAD_SLICE_BYTES);
+    if (!slice) {
+        fclose(f);
+        return;
+    }
+
+    const uint64_t slice_ns = (uint64_t)LOAD_SLICE_BYTES * 1000000000ull / LOAD_BYTES_PER_SEC;
+    for (;;) {
+        uint64_t start = monotonic_ns();
+        if (fread(slice, 1, LOAD_SLICE_BYTES, f) < LOAD_SLICE_BYTES) break;
+        uint64_t spent = monotonic_ns() - start;
+        if (spent < slice_ns) sleep_ns(slice_ns - spent);
+    }
+
+    free(slice);
+    fclose(f);
+}
+
+/* Run a freshly loaded model over silence so its internal buffers are
+ * allocated, touched and settled before the audio thread ever sees it. */
+static void warm_up_model(NeuralAudio::NeuralModel *model) {
+    flush_denormals ftz;
+    float in[FRAMES_PER_BLOCK] = {};
+    float out[FRAMES_PER_BLOCK];
+    int blocks = 0;
+    uint64_t slice_start = monotonic_ns();
+    for (int done = 0; done < WARMUP_SAMPLES; done += FRAMES_PER_BLOCK) {
+        model->Process(in, out, FRAMES_PER_BLOCK);
+        if (++blocks % WARMUP_BLOCKS_PER_SLICE == 0) {
+            sleep_ns(monotonic_ns() - slice_start);
+            slice_start = monotonic_ns();
+        }
+    }
+}
+
+/* ======================================================================== */
+/* Cabinet                                                                   */
+/* ======================================================================== */
+
+/* Uniformly partitioned FFT convolution (overlap-save). The IR is cut into
+ * CONV_BLOCK-sample partitions whose spectra are computed once at load.
+ * Each block, the last two input blocks are transformed once into a
+ * frequency-domain delay line (FDL); the output is the inverse transform of
+ * sum_p FDL[t - p] * H[p]. Spectra are stored split, re[] then im[], padded
+ * to CONV_BINS_PAD. One forward transform serves every IR convolved with
+ * the same input. */
+
+static struct {
+    float tw_re[CONV_HALF / 2], tw_im[CONV_HALF / 2];   /* half-size complex FFT */
+    float rw_re[CONV_BINS], rw_im[CONV_BINS];           /* real-FFT split */
+    uint8_t bitrev[CONV_HALF];
+} g_fft;
+
+static pthread_once_t g_fft_once = PTHREAD_ONCE_INIT;
+
+/* Convolver choice, calibrated by conv_calibrate: the FFT threshold and
+ * the timings it came from, per benchmark IR length and convolver. The
+ * table is published by done; fft_min_taps stays CONV_FFT_MIN_TAPS until
+ * then. */
+#define CONV_BENCH_MIN_TAPS 32
+#define CONV_BENCH_LENS 9          /* 32 .. MAX_IR_LEN, doubling */
+#define CONV_BENCH_REPS 32
+#define CONV_BENCH_RUNS 5          /* passes per length; the median mean counts */
+#define CONV_BENCH_GIVE_UP 8.0     /* stop timing a convolver this far behind */
+#define CONV_BENCH_MAX_PLAUSIBLE 2048  /* a later crossover means a disturbed run */
+
+enum { CONV_DIRECT, CONV_FFT_UNIFORM, CONV_ALGOS };
+
+static struct {
+    std::atomic<int> fft_min_taps;     /* IRs this long or longer use the FFT */
+    std::atomic<bool> started;         /* a loader thread has taken the calibration */
+    std::atomic<bool> done;            /* the table below is complete */
+    int taps[CONV_BENCH_LENS];
+    uint32_t mean_ns[CONV_BENCH_LENS][CONV_ALGOS];  /* 0 = not timed */
+    uint32_t max_ns[CONV_BENCH_LENS][CONV_ALGOS];
+} g_conv = { CONV_FFT_MIN_TAPS, false, false, {}, {}, {} };
+
+static void fft_init_tables(void) {
+    int bits = 0;
+    while ((1 << bits) < CONV_HALF) bits++;
+    for (int i = 0; i < CONV_HALF; i++) {
+        int r = 0;
+        for (int b = 0; b < bits; b++) {
+            if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+        }
+        g_fft.bitrev[i] = (uint8_t)r;
+    }
+    for (int k = 0; k < CONV_HALF / 2; k++) {
+        g_fft.tw_re[k] = (float)cos(2.0 * M_PI * k / CONV_HALF);
+        g_fft.tw_im[k] = (float)-sin(2.0 * M_PI * k / CONV_HALF);
+    }
+    for (int k = 0; k < CONV_BINS; k++) {
+        g_fft.rw_re[k] = (float)cos(2.0 * M_PI * k / CONV_FFT);
+        g_fft.rw_im[k] = (float)-sin(2.0 * M_PI * k / CONV_FFT);
+    }
+}
+
+/* In-place radix-2 complex FFT of CONV_HALF points, unscaled */
+static void fft_complex(float *re, float *im, bool inverse) {
+    for (int i = 0; i < CONV_HALF; i++) {
+        int j = g_fft.bitrev[i];
+        if (j > i) {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+    const float sign = inverse ? -1.0f : 1.0f;
+    for (int len = 2; len <= CONV_HALF; len <<= 1) {
+        const int half = len >> 1, step = CONV_HALF / len;
+        for (int start = 0; start < CONV_HALF; start += len) {
+            for (int k = 0; k < half; k++) {
+                const float wr = g_fft.tw_re[k * step], wi = sign * g_fft.tw_im[k * step];
+                const int a = start + k, b = a + half;
+                const float tr = re[b] * wr - im[b] * wi;
+                const float ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+/* Real FFT of CONV_FFT samples into CONV_BINS bins, through a half-size
+ * complex FFT of the even/odd samples packed as re/im */
+static void fft_real_forward(const float *x, float *out_re, float *out_im) {
+    float zr[CONV_HALF], zi[CONV_HALF];
+    for (int n = 0; n < CONV_HALF; n++) {
+        zr[n] = x[2 * n];
+        zi[n] = x[2 * n + 1];
+    }
+    fft_complex(zr, zi, false);
+    for (int k = 0; k <= CONV_HALF; k++) {
+        const int a = k & (CONV_HALF - 1), b = (CONV_HALF - k) & (CONV_HALF - 1);
+        const float er = 0.5f * (zr[a] + zr[b]), ei = 0.5f * (zi[a] - zi[b]);
+        const float odr = 0.5f * (zi[a] + zi[b]), odi = -0.5f * (zr[a] - zr[b]);
+        out_re[k] = er + g_fft.rw_re[k] * odr - g_fft.rw_im[k] * odi;
+        out_im[k] = ei + g_fft.rw_re[k] * odi + g_fft.rw_im[k] * odr;
+    }
+}
+
+/* Inverse of fft_real_forward, scaled by CONV_HALF */
+static void fft_real_inverse(const float *in_re, const float *in_im, float *x) {
+    float zr[CONV_HALF], zi[CONV_HALF];
+    for (int k = 0; k < CONV_HALF; k++) {
+        const int b = CONV_HALF - k;
+        const float er = 0.5f * (in_re[k] + in_re[b]), ei = 0.5f * (in_im[k] - in_im[b]);
+        const float dr = 0.5f * (in_re[k] - in_re[b]), di = 0.5f * (in_im[k] + in_im[b]);
+        const float odr = dr * g_fft.rw_re[k] + di * g_fft.rw_im[k];
+        const float odi = di * g_fft.rw_re[k] - dr * g_fft.rw_im[k];
+        zr[k] = er - odi;
+        zi[k] = ei + odr;
+    }
+    fft_complex(zr, zi, true);
+    for (int n = 0; n < CONV_HALF; n++) {
+        x[2 * n] = zr[n];
+        x[2 * n + 1] = zi[n];
+    }
+}
+
+/* Partition spectra of an IR, pre-scaled so the inverse needs no scaling.
+ * Returns parts * CONV_SPEC_LEN floats (free_dsp_buffer), or nullptr. */
+static float *build_spectra(const float *ir, int ir_len, int parts, int lock_memory) {
+    float *spec = alloc_dsp_buffer((size_t)parts * CONV_SPEC_LEN, lock_memory);
+    if (!spec) return nullptr;
+    float buf[CONV_FFT];
+    for (int p = 0; p < parts; p++) {
+        memset(buf, 0, sizeof(buf));
+        const int start = p * CONV_BLOCK;
+        const int len = std::min(CONV_BLOCK, ir_len - start);
+        for (int i = 0; i < len; i++) buf[i] = ir[start + i] * (1.0f / CONV_HALF);
+        float *s = spec + (size_t)p * CONV_SPEC_LEN;
+        fft_real_forward(buf, s, s + CONV_BINS_PAD);
+    }
+    return spec;
+}
+
+static bool spec_set(const cab_spec_t *spec) {
+    return spec->f || spec->h;
+}
+
+static void free_spec(cab_spec_t *spec, size_t len) {
+    free_dsp_buffer(spec->f, len);
+    free_dsp_buffer((float *)spec->h, HALF_BUF_FLOATS(len));
+    spec->f = nullptr;
+    spec->h = nullptr;
+}
+
+/* Spectra of an IR into spec, converted to half precision if half; the
+ * conversion's squared error and the spectra's energy are added to err and
+ * energy. Returns false if out of memory. */
+static bool build_cab_spec(const float *ir, int ir_len, int parts, bool half, int lock_memory,
+                           cab_spec_t *spec, double *err, double *energy) {
+    float *f = build_spectra(ir, ir_len, parts, half ? MEMLOCK_OFF : lock_memory);
+    if (!f || !half) {
+        spec->f = f;
+        return f != nullptr;
+    }
+    const size_t len = (size_t)parts * CONV_SPEC_LEN;
+    half_t *h = (half_t *)alloc_dsp_buffer(HALF_BUF_FLOATS(len), lock_memory);
+    if (h) {
+        for (size_t i = 0; i < len; i++) {
+            h[i] = (half_t)f[i];
+            const double d = (double)f[i] - (double)(float)h[i];
+            *err += d * d;
+            *energy += (double)f[i] * f[i];
+        }
+    }
+    free_dsp_buffer(f, len);
+    spec->h = h;
+    return h != nullptr;
+}
+
+/* Lite cab fit. The IR's magnitude response is sampled on a log grid,
+ * smoothed to about 1/6 octave and matched by a biquad cascade built
+ * greedily: a 2nd-order high- and low-pass at the -3 dB points, then
+ * peaking filters, each placed at the largest remaining error and sized to
+ * its width, then a few passes re-tuning every peak's gain. Phase is not
+ * fitted. Runs on the loader thread; cost is a few ms per IR. */
+#define LITE_FIT_POINTS 192
+#define LITE_FMIN 30.0
+#define LITE_FMAX 16000.0
+#define LITE_PEAK_FMIN 60.0      /* peaks are placed within this band only */
+#define LITE_PEAK_FMAX 12000.0
+#define LITE_MAX_PEAK_DB 18.0
+#define LITE_MIN_ERROR_DB 0.5    /* stop adding peaks below this error */
+#define LITE_REFINE_PASSES 4
+
+enum { BQ_HIGHPASS, BQ_LOWPASS, BQ_PEAK, BQ_LOWSHELF, BQ_HIGHSHELF };
+
+static double lite_freq(int k) {
+    return LITE_FMIN * pow(LITE_FMAX / LITE_FMIN, (double)k / (LITE_FIT_POINTS - 1));
+}
+
+/* RBJ audio-EQ-cookbook designs at the module sample rate */
+static biquad_t biquad_design(int type, double f0, double q, double gain_db) {
+    const double w0 = 2.0 * M_PI * f0 / MOVE_SAMPLE_RATE;
+    const double cw = cos(w0);
+    const double alpha = sin(w0) / (2.0 * q);
+    const double a = pow(10.0, gain_db / 40.0);
+    double b0, b1, b2, a0, a1, a2;
+    if (type == BQ_HIGHPASS) {
+        b0 = (1.0 + cw) / 2.0;  b1 = -(1.0 + cw);  b2 = b0;
+        a0 = 1.0 + alpha;       a1 = -2.0 * cw;    a2 = 1.0 - alpha;
+    } else if (type == BQ_LOWPASS) {
+        b0 = (1.0 - cw) / 2.0;  b1 = 1.0 - cw;     b2 = b0;
+        a0 = 1.0 + alpha;       a1 = -2.0 * cw;    a2 = 1.0 - alpha;
+    } else if (type == BQ_PEAK) {
+        b0 = 1.0 + alpha * a;   b1 = -2.0 * cw;    b2 = 1.0 - alpha * a;
+        a0 = 1.0 + alpha / a;   a1 = -2.0 * cw;    a2 = 1.0 - alpha / a;
+    } else {
+        const double sa = 2.0 * sqrt(a) * alpha;
+        const double sign = type == BQ_LOWSHELF ? 1.0 : -1.0;
+        b0 = a * ((a + 1.0) - sign * (a - 1.0) * cw + sa);
+        b1 = sign * 2.0 * a * ((a - 1.0) - sign * (a + 1.0) * cw);
+        b2 = a * ((a + 1.0) - sign * (a - 1.0) * cw - sa);
+        a0 = (a + 1.0) + sign * (a - 1.0) * cw + sa;
+        a1 = -sign * 2.0 * ((a - 1.0) + sign * (a + 1.0) * cw);
+        a2 = (a + 1.0) + sign * (a - 1.0) * cw - sa;
+    }
+    biquad_t bq = { (float)(b0 / a0), (float)(b1 / a0), (float)(b2 / a0),
+                    (float)(a1 / a0), (float)(a2 / a0) };
+    return bq;
+}
+
+/* Magnitude of a biquad in dB at each grid point (trig precomputed) */
+static void biquad_add_db(const biquad_t *bq, const double (*trig)[4], double *db) {
+    for (int k = 0; k < LITE_FIT_POINTS; k++) {
+        const double c1 = trig[k][0], s1 = trig[k][1], c2 = trig[k][2], s2 = trig[k][3];
+        const double nr = bq->b0 + bq->b1 * c1 + bq->b2 * c2;
+        const double ni = -(bq->b1 * s1 + bq->b2 * s2);
+        const double dr = 1.0 + bq->a1 * c1 + bq->a2 * c2;
+        const double di = -(bq->a1 * s1 + bq->a2 * s2);
+        db[k] += 10.0 * log10((nr * nr + ni * ni) / (dr * dr + di * di) + 1e-30);
+    }
+}
+
+/* Fill resid with target minus the response of gain_db and all sections */
+static double lite_residual(const lite_cab_t *lite, double gain_db, const double *target,
+                            const double (*trig)[4], double *resid) {
+    double model[LITE_FIT_POINTS];
+    for (int k = 0; k < LITE_FIT_POINTS; k++) model[k] = gain_db;
+    for (int s = 0; s < lite->sections; s++) biquad_add_db(&lite->sec[s], trig, model);
+    double sq = 0.0;
+    for (int k = 0; k < LITE_FIT_POINTS; k++) {
+        resid[k] = target[k] - model[k];
+        sq += resid[k] * resid[k];
+    }
+    return sqrt(sq / LITE_FIT_POINTS);
+}
+
+static void fit_lite_cab(const float *ir, int ir_len, lite_cab_t *lite) {
+    double trig[LITE_FIT_POINTS][4];
+    double power[LITE_FIT_POINTS];
+    double target[LITE_FIT_POINTS];
+    double resid[LITE_FIT_POINTS];
+
+    /* IR magnitude on the grid: one DFT bin per point, by phasor rotation */
+    for (int k = 0; k < LITE_FIT_POINTS; k++) {
+        const double w = 2.0 * M_PI * lite_freq(k) / MOVE_SAMPLE_RATE;
+        trig[k][0] = cos(w);
+        trig[k][1] = sin(w);
+        trig[k][2] = cos(2.0 * w);
+        trig[k][3] = sin(2.0 * w);
+        double re = 0.0, im = 0.0, c = 1.0, s = 0.0;
+        for (int n = 0; n < ir_len; n++) {
+            re += ir[n] * c;
+            im -= ir[n] * s;
+            const double cn = c * trig[k][0] - s * trig[k][1];
+            s = s * trig[k][0] + c * trig[k][1];
+            c = cn;
+        }
+        power[k] = re * re + im * im;
+    }
+    for (int k = 0; k < LITE_FIT_POINTS; k++) {
+        double sum = 0.0;
+        int count = 0;
+        for (int j = std::max(0, k - 2); j <= std::min(LITE_FIT_POINTS - 1, k + 2); j++) {
+            sum += power[j];
+            count++;
+        }
+        target[k] = 10.0 * log10(sum / count + 1e-30);
+    }
+
+    /* Reference level: mean over the cab's main band */
+    double ref = 0.0;
+    int ref_count = 0;
+    for (int k = 0; k < LITE_FIT_POINTS; k++) {
+        if (lite_freq(k) >= 200.0 && lite_freq(k) <= 4000.0) {
+            ref += target[k];
+            ref_count++;
+        }
+    }
+    ref /= ref_count;
+
+    lite->sections = 0;
+    int lo = 0, hi = LITE_FIT_POINTS - 1;
+    while (lo < LITE_FIT_POINTS - 1 && target[lo] < ref - 3.0) lo++;
+    while (hi > 0 && target[hi] < ref - 3.0) hi--;
+    if (lo > 0) lite->sec[lite->sections++] = biquad_design(BQ_HIGHPASS, lite_freq(lo), M_SQRT1_2, 0.0);
+    if (hi < LITE_FIT_POINTS - 1 && hi > lo) {
+        lite->sec[lite->sections++] = biquad_design(BQ_LOWPASS, lite_freq(hi), M_SQRT1_2, 0.0);
+    }
+    const int first_peak = lite->sections;
+
+    /* Greedy peaks */
+    double peak_f[LITE_MAX_SECTIONS], peak_q[LITE_MAX_SECTIONS], peak_db[LITE_MAX_SECTIONS];
+    int peak_k[LITE_MAX_SECTIONS];
+    double gain_db = ref;
+    while (lite->sections < LITE_MAX_SECTIONS) {
+        lite_residual(lite, gain_db, target, trig, resid);
+        int kmax = -1;
+        for (int k = 0; k < LITE_FIT_POINTS; k++) {
+            if (lite_freq(k) < LITE_PEAK_FMIN || lite_freq(k) > LITE_PEAK_FMAX) continue;
+            if (kmax < 0 || fabs(resid[k]) > fabs(resid[kmax])) kmax = k;
+        }
+        if (kmax < 0 || fabs(resid[kmax]) < LITE_MIN_ERROR_DB) break;
+
+        const double half = resid[kmax] / 2.0;
+        int k1 = kmax, k2 = kmax;
+        while (k1 > 0 && resid[k1 - 1] * half > half * half) k1--;
+        while (k2 < LITE_FIT_POINTS - 1 && resid[k2 + 1] * half > half * half) k2++;
+        const double bw = std::max(log2(lite_freq(k2) / lite_freq(k1)), 1.0 / 6.0);
+        const double q = clampf((float)(1.0 / (2.0 * sinh(M_LN2 / 2.0 * bw))), 0.4f, 8.0f);
+
+        const int i = lite->sections - first_peak;
+        peak_k[i] = kmax;
+        peak_f[i] = lite_freq(kmax);
+        peak_q[i] = q;
+        peak_db[i] = clampf((float)resid[kmax], -LITE_MAX_PEAK_DB, LITE_MAX_PEAK_DB);
+        lite->sec[lite->sections++] = biquad_design(BQ_PEAK, peak_f[i], q, peak_db[i]);
+    }
+
+    /* Re-tune peak gains and overall level against each other */
+    for (int pass = 0; pass < LITE_REFINE_PASSES; pass++) {
+        for (int i = 0; i < lite->sections - first_peak; i++) {
+            lite_residual(lite, gain_db, target, trig, resid);
+            peak_db[i] = clampf((float)(peak_db[i] + resid[peak_k[i]]), -LITE_MAX_PEAK_DB, LITE_MAX_PEAK_DB);
+            lite->sec[first_peak + i] = biquad_design(BQ_PEAK, peak_f[i], peak_q[i], peak_db[i]);
+        }
+        lite_residual(lite, gain_db, target, trig, resid);
+        double mean = 0.0;
+        for (int k = 0; k < LITE_FIT_POINTS; k++) mean += resid[k];
+        gain_db += mean / LITE_FIT_POINTS;
+    }
+
+    lite->gain = (float)pow(10.0, gain_db / 20.0);
+    lite->error_db = (float)lite_residual(lite, gain_db, target, trig, resid);
+}
+
+static void destroy_cab(nam_cab_t *cab) {
+    if (!cab) return;
+    const size_t spec_len = (size_t)cab->parts * CONV_SPEC_LEN;
+    for (int c = 0; c < 2; c++) {
+        free_dsp_buffer(cab->ir[c], MAX_IR_LEN);
+        free_spec(&cab->spec[c], spec_len);
+        free_spec(&cab->spec_a[c], spec_len);
+        free_spec(&cab->spec_b[c], spec_len);
+    }
+    free(cab);
+}
+
+/* Drop a cab that is no longer playing. Bank cabs live until the instance
+ * is destroyed. */
+static void free_cab(nam_cab_t *cab) {
+    if (cab && !cab->banked) destroy_cab(cab);
+}
+
+/* Memory held by a cab's IRs and spectra */
+static size_t cab_bytes(const nam_cab_t *cab) {
+    const size_t spec_len = (size_t)cab->parts * CONV_SPEC_LEN;
+    const size_t spec_bytes = cab->spec[0].h ? HALF_BUF_FLOATS(spec_len) * sizeof(float)
+                                             : spec_len * sizeof(float);
+    const size_t per_channel = MAX_IR_LEN * sizeof(float) + spec_bytes * (spec_set(&cab->spec_b[0]) ? 3 : 1);
+    return sizeof(nam_cab_t) + (size_t)cab->channels * per_channel;
+}
+
+static bool eq_is_flat(const cab_eq_t *eq) {
+    return !eq || (eq->bass == 0.0f && eq->mid == 0.0f && eq->treble == 0.0f);
+}
+
+/* Run an IR (MAX_IR_LEN buffer) through the EQ filters, so the convolution
+ * applies them for free. The IR grows by up to EQ_TAIL_LEN samples to keep
+ * the filters' ringing. Returns the new length. */
+static int bake_cab_eq(float *ir, int ir_len, const cab_eq_t *eq) {
+    if (eq_is_flat(eq)) return ir_len;
+    const biquad_t bq[3] = {
+        biquad_design(BQ_LOWSHELF, EQ_BASS_HZ, M_SQRT1_2, eq->bass),
+        biquad_design(BQ_PEAK, EQ_MID_HZ, EQ_MID_Q, eq->mid),
+        biquad_design(BQ_HIGHSHELF, EQ_TREBLE_HZ, M_SQRT1_2, eq->treble),
+    };
+    const int len = std::min(MAX_IR_LEN, ir_len + EQ_TAIL_LEN);
+    for (int i = ir_len; i < len; i++) ir[i] = 0.0f;
+    for (int s = 0; s < 3; s++) {
+        double z1 = 0.0, z2 = 0.0;
+        for (int i = 0; i < len; i++) {
+            const double x = ir[i];
+            const double y = bq[s].b0 * x + z1;
+            z1 = bq[s].b1 * x - bq[s].a1 * y + z2;
+            z2 = bq[s].b2 * x - bq[s].a2 * y;
+            ir[i] = (float)y;
+        }
+    }
+    return len;
+}
+
+/* An IR file read into scratch buffers, EQ applied */
+typedef struct {
+    float *ir[2];
+    int len;
+    int channels;
+} ir_file_t;
+
+static bool read_ir_file(const char *path, const cab_eq_t *eq, ir_file_t *irf) {
+    irf->ir[0] = alloc_dsp_buffer(MAX_IR_LEN, MEMLOCK_OFF);
+    irf->ir[1] = alloc_dsp_buffer(MAX_IR_LEN, MEMLOCK_OFF);
+    irf->len = 0;
+    if (irf->ir[0] && irf->ir[1]) {
+        irf->len = load_wav_ir(path, irf->ir[0], irf->ir[1], MAX_IR_LEN, &irf->channels);
+    }
+    if (irf->len <= 0) {
+        char msg[MAX_PATH_LEN + 64];
+        snprintf(msg, sizeof(msg), "NAM: failed to load cab IR %s", path);
+        plugin_log(msg);
+        return false;
+    }
+    const int len = bake_cab_eq(irf->ir[0], irf->len, eq);
+    if (irf->channels == 2) bake_cab_eq(irf->ir[1], irf->len, eq);
+    irf->len = len;
+    return true;
+}
+
+static void free_ir_file(ir_file_t *irf) {
+    free_dsp_buffer(irf->ir[0], MAX_IR_LEN);
+    free_dsp_buffer(irf->ir[1], MAX_IR_LEN);
+}
+
+/* Read one or two cab IR files (path2 nullptr or "" for one) and build
+ * everything derived from them, with eq (nullptr = flat) baked in. The cab
+ * is stereo if either file is; a mono file plays on both sides. A dual cab
+ * keeps both files' spectra for live blending and premixes ir/spec at
+ * blend, which is what plays while the blend stays put. With half the
+ * spectra are kept in fp16. Returns nullptr on failure; free with free_cab. */
+static nam_cab_t *load_cab(const char *path, const char *path2, float blend, const cab_eq_t *eq,
+                           bool half, int lock_memory) {
+    nam_cab_t *cab = (nam_cab_t *)calloc(1, sizeof(nam_cab_t));
+    if (!cab) return nullptr;
+
+    const bool dual = path2 && path2[0];
+    ir_file_t fa = {}, fb = {};
+    bool ok = read_ir_file(path, eq, &fa) && (!dual || read_ir_file(path2, eq, &fb));
+
+    cab->channels = std::max(fa.channels, dual ? fb.channels : 1);
+    cab->ir_len = std::max(fa.len, fb.len);
+    cab->blend = dual ? clampf(blend, 0.0f, 1.0f) : 0.0f;
+    cab->parts = cab->ir_len >= g_conv.fft_min_taps.load(std::memory_order_relaxed) ? (cab->ir_len + CONV_BLOCK - 1) / CONV_BLOCK : 0;
+    double half_err = 0.0, half_energy = 0.0;
+    for (int c = 0; ok && c < cab->channels; c++) {
+        /* Scratch buffers are zero past each file's length */
+        const float *ia = fa.ir[fa.channels == 2 ? c : 0];
+        const float *ib = dual ? fb.ir[fb.channels == 2 ? c : 0] : nullptr;
+        float *ir = cab->ir[c] = alloc_dsp_buffer(MAX_IR_LEN, lock_memory);
+        if (!ir) {
+            ok = false;
+            break;
+        }
+        for (int i = 0; i < cab->ir_len; i++) {
+            ir[i] = dual ? ia[i] * (1.0f - cab->blend) + ib[i] * cab->blend : ia[i];
+        }
+        if (cab->parts > 0) {
+            ok = build_cab_spec(ir, cab->ir_len, cab->parts, half, lock_memory, &cab->spec[c],
+                                &half_err, &half_energy);
+            if (ok && dual) {
+                ok = build_cab_spec(ia, fa.len, cab->parts, half, lock_memory, &cab->spec_a[c],
+                                    &half_err, &half_energy) &&
+                     build_cab_spec(ib, fb.len, cab->parts, half, lock_memory, &cab->spec_b[c],
+                                    &half_err, &half_energy);
+            }
+        }
+    }
+    free_ir_file(&fa);
+    free_ir_file(&fb);
+    if (!ok) {
+        free_cab(cab);
+        return nullptr;
+    }
+
+    /* One lite cascade serves both sides: fit it to their average */
+    if (cab->channels == 2) {
+        float *mid = alloc_dsp_buffer(MAX_IR_LEN, MEMLOCK_OFF);
+        if (mid) {
+            for (int i = 0; i < cab->ir_len; i++) mid[i] = 0.5f * (cab->ir[0][i] + cab->ir[1][i]);
+            fit_lite_cab(mid, cab->ir_len, &cab->lite);
+            free_dsp_buffer(mid, MAX_IR_LEN);
+        } else {
+            cab->lite.error_db = -1.0f;
+        }
+    } else {
+        fit_lite_cab(cab->ir[0], cab->ir_len, &cab->lite);
+    }
+    char msg[MAX_PATH_LEN + 64];
+    snprintf(msg, sizeof(msg), "NAM: lite cab fit %d sections, %.2f dB RMS error",
+             cab->lite.sections, cab->lite.error_db);
+    plugin_log(msg);
+    if (half_energy > 0.0) {
+        cab->half_error_db = (float)(10.0 * log10(std::max(half_err, 1e-30) / half_energy));
+        snprintf(msg, sizeof(msg), "NAM: cab spectra in fp16, %.1f dB error", cab->half_error_db);
+        plugin_log(msg);
+    }
+    return cab;
+}
+
+/* Direct time-domain convolution of the last frames samples of the
+ * circular history (already pushed) into out. The buffer is CAB_HIST_LEN
+ * long whatever the IR, so IRs of any length can share it. */
+static void apply_cab_ir(const nam_instance_t *inst, const float *ir, int ir_len,
+                         float *out, int frames) {
+    const float *hist = inst->cab_history;
+    const int hist_len = CAB_HIST_LEN;
+    int pos = inst->cab_hist_pos - frames;
+    if (pos < 0) pos += hist_len;
+
+    for (int i = 0; i < frames; i++) {
+        /* Convolve: sum of ir[k] * hist[pos-k] for k=0..ir_len-1 */
+        float sum = 0.0f;
+        int p = pos;
+        for (int k = 0; k < ir_len; k++) {
+            sum += ir[k] * hist[p];
+            if (--p < 0) p = hist_len - 1;
+        }
+
+        out[i] = sum;
+        if (++pos >= hist_len) pos = 0;
+    }
+}
+
+/* Record a block of cab input in the direct-convolution history. This and
+ * conv_push run on every block that goes through a cab, whichever path
+ * renders it, so switching between paths never plays stale history. */
+static void push_cab_history(nam_instance_t *inst, const float *audio, int frames) {
+    float *hist = inst->cab_history;
+    int pos = inst->cab_hist_pos;
+    for (int i = 0; i < frames; i++) {
+        hist[pos] = audio[i];
+        if (++pos >= CAB_HIST_LEN) pos = 0;
+    }
+    inst->cab_hist_pos = pos;
+}
+
+/* Transform the newest full input block into the FDL */
+static void conv_push(nam_instance_t *inst, const float *audio) {
+    float *in = inst->conv_in;
+    memcpy(in, in + CONV_BLOCK, CONV_BLOCK * sizeof(float));
+    memcpy(in + CONV_BLOCK, audio, CONV_BLOCK * sizeof(float));
+    inst->fdl_pos = (inst->fdl_pos + CONV_MAX_PARTS - 1) % CONV_MAX_PARTS;
+    float *x = inst->fdl + (size_t)inst->fdl_pos * CONV_SPEC_LEN;
+    fft_real_forward(in, x, x + CONV_BINS_PAD);
+}
+
+/* acc = sum over the first parts partitions of FDL[t - p] * spec[p], for
+ * float or fp16 spectra */
+template <typename T>
+static void conv_mac(const nam_instance_t *inst, const T *spec, int parts, float *acc) {
+    float *acc_re = acc, *acc_im = acc + CONV_BINS_PAD;
+    memset(acc, 0, CONV_SPEC_LEN * sizeof(float));
+    int slot = inst->fdl_pos;
+    for (int p = 0; p < parts; p++) {
+        const float *x = inst->fdl + (size_t)slot * CONV_SPEC_LEN;
+        const T *h = spec + (size_t)p * CONV_SPEC_LEN;
+        const float *xr = x, *xi = x + CONV_BINS_PAD;
+        const T *hr = h, *hi = h + CONV_BINS_PAD;
+        for (int k = 0; k < CONV_BINS; k++) {
+            const float h_re = hr[k], h_im = hi[k];
+            acc_re[k] += xr[k] * h_re - xi[k] * h_im;
+            acc_im[k] += xr[k] * h_im + xi[k] * h_re;
+        }
+        if (++slot == CONV_MAX_PARTS) slot = 0;
+    }
+}
+
+static void conv_mac_spec(const nam_instance_t *inst, const cab_spec_t *spec, int parts, float *acc) {
+    if (spec->h) conv_mac(inst, spec->h, parts, acc);
+    else conv_mac(inst, spec->f, parts, acc);
+}
+
+/* Back to the time domain: the second half of the inverse is the output */
+static void conv_output(nam_instance_t *inst, const float *acc, float *out) {
+    fft_real_inverse(acc, acc + CONV_BINS_PAD, inst->conv_out);
+    memcpy(out, inst->conv_out + CONV_BLOCK, CONV_BLOCK * sizeof(float));
+}
+
+/* FFT convolution of the newest full block with one channel of a cab into out. A dual cab whose
+ * blend has moved since its premix was built is rendered from both IRs'
+ * spectra over the same FDL, weighted and summed before the single inverse
+ * transform; otherwise the premixed spectra are used. */
+static void apply_cab_fft(nam_instance_t *inst, const nam_cab_t *cab, int channel, int parts,
+                          float blend, float *out) {
+    float *acc = inst->conv_acc;
+    if (!spec_set(&cab->spec_b[channel]) || fabsf(blend - cab->blend) < 1e-4f) {
+        conv_mac_spec(inst, &cab->spec[channel], parts, acc);
+    } else {
+        float *acc_b = inst->conv_acc2;
+        conv_mac_spec(inst, &cab->spec_a[channel], parts, acc);
+        conv_mac_spec(inst, &cab->spec_b[channel], parts, acc_b);
+        for (int k = 0; k < CONV_SPEC_LEN; k++) acc[k] = acc[k] * (1.0f - blend) + acc_b[k] * blend;
+    }
+    conv_output(inst, acc, out);
+}
+
+/* Lite cab: run the fitted cascade in-place, one section over the whole
+ * block at a time. History left by another cab's fit, or from before lite
+ * mode was last off, is cleared first so it cannot ring through. */
+static void apply_lite_cab(nam_instance_t *inst, const nam_cab_t *cab, float *audio, int frames) {
+    const lite_cab_t *lite = &cab->lite;
+    float *z = inst->lite_state;
+    if (inst->lite_cab != cab) {
+        memset(z, 0, ARENA_LITE_LEN * sizeof(float));
+        inst->lite_cab = cab;
+    }
+    for (int s = 0; s < lite->sections; s++) {
+        const biquad_t bq = lite->sec[s];
+        float z1 = z[2 * s], z2 = z[2 * s + 1];
+        for (int i = 0; i < frames; i++) {
+            const float x = audio[i];
+            const float y = bq.b0 * x + z1;
+            z1 = bq.b1 * x - bq.a1 * y + z2;
+            z2 = bq.b2 * x - bq.a2 * y;
+            audio[i] = y;
+        }
+        z[2 * s] = z1;
+        z[2 * s + 1] = z2;
+    }
+    for (int i = 0; i < frames; i++) audio[i] *= lite->gain;
+}
+
+/* Full convolution of the newest block (already in both histories) with
+ * one channel of a cab into out: partitioned FFT on full blocks, direct for
+ * odd-sized blocks and for IRs - or budget caps - under the calibrated
+ * threshold, capped at taps. A mono cab plays its only IR on either channel. */
+static void render_cab(nam_instance_t *inst, const nam_cab_t *cab, int channel, float blend,
+                       int taps, int frames, float *out) {
+    if (channel >= cab->channels) channel = 0;
+    if (frames == CONV_BLOCK && cab->parts > 0 && std::min(cab->ir_len, taps) >= g_conv.fft_min_taps.load(std::memory_order_relaxed)) {
+        const int parts = std::min(cab->parts, std::max(1, taps / CONV_BLOCK));
+        apply_cab_fft(inst, cab, channel, parts, blend, out);
+    } else {
+        apply_cab_ir(inst, cab->ir[channel], std::min(cab->ir_len, taps), out, frames);
+    }
+}
+
+/* One block of a linear CAB_FADE_LEN crossfade from old to audio, into
+ * audio; pos samples of the fade are already done */
+static void crossfade_block(const float *old, float *audio, int frames, int pos) {
+    const float step = 1.0f / CAB_FADE_LEN;
+    for (int i = 0; i < frames; i++) {
+        const float t = std::min(1.0f, step * (pos + i + 1));
+        audio[i] = old[i] + (audio[i] - old[i]) * t;
+    }
+}
+
+/* Audio thread: hand an applied update - now holding the replaced
+ * model/IR - back for freeing */
+static void retire_update(nam_instance_t *inst, nam_update_t *u) {
+    uint32_t head = inst->retire_head.load(std::memory_order_relaxed);
+    uint32_t tail = inst->retire_tail.load(std::memory_order_acquire);
+    if (head - tail < RETIRE_QUEUE_SIZE) {
+        inst->retire_queue[head & (RETIRE_QUEUE_SIZE - 1)] = u;
+        inst->retire_head.store(head + 1, std::memory_order_release);
+    }
+    /* else: reaper is far behind - leak rather than free on this thread */
+}
+
+/* Audio thread: stop fading and let go of whatever kept the old cab alive */
+static void end_cab_fade(nam_instance_t *inst) {
+    if (inst->fade_update) {
+        retire_update(inst, inst->fade_update);
+        inst->fade_update = nullptr;
+    }
+    inst->fade_rig.store(nullptr, std::memory_order_seq_cst);
+    inst->fade_cab = nullptr;
+}
+
+/* Audio thread: start fading out old. The caller has ended any earlier
+ * fade and made sure old stays alive (fade_update or fade_rig). */
+static void start_cab_fade(nam_instance_t *inst, const nam_cab_t *old) {
+    inst->fade_cab = old;
+    inst->fade_pos = 0;
+    inst->fade_taps = inst->cab_taps;
+    inst->stat_cab_fades.fetch_add(1, std::memory_order_relaxed);
+}
+
+/* ======================================================================== */
+/* Convolution benchmark                                                     */
+/* ======================================================================== */
+
+/* Which convolver a cab uses is decided by IR length. The crossover depends
+ * on the CPU, so a loader thread of the first instance in the process times
+ * every convolver through the same interface - render one block of a cab
+ * held in a scratch instance - over IR lengths from CONV_BENCH_MIN_TAPS to
+ * MAX_IR_LEN, and sets the FFT threshold from where the FFT overtakes
+ * direct convolution. Each length is timed in CONV_BENCH_RUNS interleaved
+ * passes and the median pass counts, so one preempted pass does not move
+ * the threshold; a crossover that is still implausible keeps the default.
+ * The forward transform is not timed: conv_push runs on every cab block
+ * whichever convolver renders it. Results are read through "conv_bench". */
+
+typedef struct {
+    const char *name;
+    void (*render)(nam_instance_t *inst, const nam_cab_t *cab, int taps, float *out);
+} conv_algo_t;
+
+static void bench_direct(nam_instance_t *inst, const nam_cab_t *cab, int taps, float *out) {
+    apply_cab_ir(inst, cab->ir[0], taps, out, CONV_BLOCK);
+}
+
+static void bench_fft(nam_instance_t *inst, const nam_cab_t *cab, int taps, float *out) {
+    apply_cab_fft(inst, cab, 0, (taps + CONV_BLOCK - 1) / CONV_BLOCK, 0.0f, out);
+}
+
+static const conv_algo_t k_conv_algos[CONV_ALGOS] = {
+    { "direct", bench_direct },
+    { "fft",    bench_fft },
+};
+
+/* Time the convolvers and set g_conv.fft_min_taps. Runs once, on the
+ * first loader thread to start; cabs meanwhile use the default threshold,
+ * which also stays on any allocation failure. */
+static void conv_calibrate(void) {
+    void *mem = nullptr;
+    if (posix_memalign(&mem, alignof(nam_instance_t), sizeof(nam_instance_t)) != 0) return;
+    memset(mem, 0, sizeof(nam_instance_t));
+    nam_instance_t *inst = (nam_instance_t *)mem;
+    float *arena = alloc_dsp_buffer(ARENA_LEN, MEMLOCK_OFF);
+    float *ir = alloc_dsp_buffer(MAX_IR_LEN, MEMLOCK_OFF);
+    float *spec = nullptr;
+    if (ir) {
+        /* A decaying noise IR and a full history, so no path sees zeros */
+        uint32_t seed = 1;
+        for (int i = 0; i < MAX_IR_LEN; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            ir[i] = ((int32_t)seed / 2147483648.0f) * expf(-i / 2048.0f);
+        }
+        spec = build_spectra(ir, MAX_IR_LEN, CONV_MAX_PARTS, MEMLOCK_OFF);
+    }
+    if (!arena || !spec) {
+        free_dsp_buffer(spec, (size_t)CONV_MAX_PARTS * CONV_SPEC_LEN);
+        free_dsp_buffer(ir, MAX_IR_LEN);
+        free_dsp_buffer(arena, ARENA_LEN);
+        free(inst);
+        return;
+    }
+    inst->cab_history = arena + ARENA_CAB_HIST;
+    inst->conv_in = arena + ARENA_CONV_IN;
+    inst->conv_acc = arena + ARENA_CONV_ACC;
+    inst->conv_acc2 = arena + ARENA_CONV_ACC2;
+    inst->conv_out = arena + ARENA_CONV_OUT;
+    inst->fdl = arena + ARENA_FDL;
+    float *block = arena + ARENA_MONO_IN;
+    float *out = arena + ARENA_MONO_OUT;
+
+    nam_cab_t cab = {};
+    cab.channels = 1;
+    cab.ir[0] = ir;
+    cab.ir_len = MAX_IR_LEN;
+    cab.parts = CONV_MAX_PARTS;
+    cab.spec[0].f = spec;
+    uint32_t seed = 2;
+    for (int b = 0; b < CAB_HIST_LEN / CONV_BLOCK + 1; b++) {
+        for (int i = 0; i < CONV_BLOCK; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            block[i] = (int32_t)seed / 2147483648.0f;
+        }
+        push_cab_history(inst, block, CONV_BLOCK);
+        conv_push(inst, block);
+    }
+
+    bool timing[CONV_ALGOS];
+    for (int a = 0; a < CONV_ALGOS; a++) timing[a] = true;
+    int crossover = 0;
+    for (int l = 0; l < CONV_BENCH_LENS; l++) {
+        const int taps = std::min(MAX_IR_LEN, CONV_BENCH_MIN_TAPS << l);
+        g_conv.taps[l] = taps;
+        uint32_t best = UINT32_MAX;
+        uint32_t run_mean[CONV_ALGOS][CONV_BENCH_RUNS];
+        uint64_t worst[CONV_ALGOS] = {};
+        for (int a = 0; a < CONV_ALGOS; a++) {
+            if (timing[a]) k_conv_algos[a].render(inst, &cab, taps, out);   /* warm up */
+        }
+        for (int run = 0; run < CONV_BENCH_RUNS; run++) {
+            for (int a = 0; a < CONV_ALGOS; a++) {
+                if (!timing[a]) continue;
+                uint64_t total = 0;
+                for (int r = 0; r < CONV_BENCH_REPS; r++) {
+                    const uint64_t t0 = monotonic_ns();
+                    k_conv_algos[a].render(inst, &cab, taps, out);
+                    const uint64_t dt = monotonic_ns() - t0;
+                    total += dt;
+                    worst[a] = std::max(worst[a], dt);
+                }
+                run_mean[a][run] = (uint32_t)std::min<uint64_t>(total / CONV_BENCH_REPS, UINT32_MAX);
+            }
+        }
+        for (int a = 0; a < CONV_ALGOS; a++) {
+            if (!timing[a]) continue;
+            std::sort(run_mean[a], run_mean[a] + CONV_BENCH_RUNS);
+            g_conv.mean_ns[l][a] = std::max<uint32_t>(run_mean[a][CONV_BENCH_RUNS / 2], 1);
+            g_conv.max_ns[l][a] = (uint32_t)std::min<uint64_t>(worst[a], UINT32_MAX);
+            best = std::min(best, g_conv.mean_ns[l][a]);
+        }
+        for (int a = 0; a < CONV_ALGOS; a++) {
+            if (timing[a] && g_conv.mean_ns[l][a] > best * CONV_BENCH_GIVE_UP) timing[a] = false;
+        }
+        if (!crossover && timing[CONV_FFT_UNIFORM] &&
+            g_conv.mean_ns[l][CONV_FFT_UNIFORM] <= g_conv.mean_ns[l][CONV_DIRECT]) {
+            crossover = taps;
+        }
+    }
+    char msg[96];
+    if (crossover && crossover <= CONV_BENCH_MAX_PLAUSIBLE) {
+        g_conv.fft_min_taps.store(crossover, std::memory_order_relaxed);
+        snprintf(msg, sizeof(msg), "NAM: FFT convolution from %d taps", crossover);
+    } else {
+        snprintf(msg, sizeof(msg), "NAM: implausible convolution timings, FFT from %d taps",
+                 CONV_FFT_MIN_TAPS);
+    }
+    g_conv.done.store(true, std::memory_order_release);
+    plugin_log(msg);
+    free_dsp_buffer(spec, (size_t)CONV_MAX_PARTS * CONV_SPEC_LEN);
+    free_dsp_buffer(ir, MAX_IR_LEN);
+    free_dsp_buffer(arena, ARENA_LEN);
+    free(inst);
+}
+
+/* "conv_bench": the calibration table, one row per IR length */
+static int format_conv_bench(char *buf, int buf_len) {
+    const bool done = g_conv.done.load(std::memory_order_acquire);
+    int written = snprintf(buf, buf_len,
+                           "{\"block\":%d,\"fft_min_taps\":%d,\"calibrated\":%d,\"results\":[",
+                           CONV_BLOCK, g_conv.fft_min_taps.load(std::memory_order_relaxed), done ? 1 : 0);
+    for (int l = 0; done && l < CONV_BENCH_LENS && written < buf_len; l++) {
+        written += snprintf(buf + written, buf_len - written, "%s{\"taps\":%d", l ? "," : "",
+                            g_conv.taps[l]);
+        for (int a = 0; a < CONV_ALGOS && written < buf_len; a++) {
+            const char *name = k_conv_algos[a].name;
+            if (g_conv.mean_ns[l][a]) {
+                written += snprintf(buf + written, buf_len - written, ",\"%s_ns\":%u,\"%s_max_ns\":%u",
+                                    name, g_conv.mean_ns[l][a], name, g_conv.max_ns[l][a]);
+            } else {
+                written += snprintf(buf + written, buf_len - written,
+                                    ",\"%s_ns\":null,\"%s_max_ns\":null", name, name);
+            }
+        }
+        if (written < buf_len) written += snprintf(buf + written, buf_len - written, "}");
+    }
+    if (written < buf_len) written += snprintf(buf + written, buf_len - written, "]}");
+    return written;
+}
+
+/* ======================================================================== */
+/* Rig slots                                                                 */
+/* ======================================================================== */
+
+/* Slots let a foot controller jump between complete rigs with no I/O or
+ * allocation at switch time: each slot owns its own model instance and IR,
+ * loaded and warmed in the background. Switching is a pointer swap in
+ * process_block; the shared cab history carries over. */
+
+static void free_rig(nam_rig_t *rig) {
+    if (!rig) return;
+    delete rig->model;
+    free_cab(rig->cab);
+    free(rig);
+}
+
+/* Free retired rigs the audio thread has let go of. Control thread only. */
+static void reap_retired_rigs(nam_instance_t *inst) {
+    nam_rig_t *in_use = inst->rig_in_use.load(std::memory_order_seq_cst);
+    nam_rig_t *fading = inst->fade_rig.load(std::memory_order_seq_cst);
+    for (int i = 0; i < MAX_RETIRED_RIGS; i++) {
+        nam_rig_t *r = inst->retired_rigs[i];
+        if (r && r != in_use && r != fading) {
+            free_rig(r);
+            inst->retired_rigs[i] = nullptr;
+        }
+    }
+}
+
+static void retire_rig(nam_instance_t *inst, nam_rig_t *rig) {
+    if (!rig) return;
+    for (int i = 0; i < MAX_RETIRED_RIGS; i++) {
+        if (!inst->retired_rigs[i]) {
+            inst->retired_rigs[i] = rig;
+            reap_retired_rigs(inst);
+            return;
+        }
+    }
+    /* No room - leak rather than free something the audio thread may hold */
+    plugin_log("NAM: retired rig list full, leaking rig");
+}
+
+/* Publish a loaded rig into a slot. If that slot is the one playing, ask
+ * the audio thread to move to the new rig too. */
+static void publish_slot(nam_instance_t *inst, int slot, nam_rig_t *rig) {
+    nam_rig_t *old = inst->slots[slot].exchange(rig, std::memory_order_seq_cst);
+    if (inst->active_slot.load(std::memory_order_acquire) == slot) {
+        inst->slot_request.store(slot, std::memory_order_release);
+    }
+    retire_rig(inst, old);
+}
+
+static void clear_slot(nam_instance_t *inst, int slot) {
+    if (slot < 0 || slot >= MAX_SLOTS) return;
+    pthread_mutex_lock(&inst->publish_lock);
+    publish_slot(inst, slot, nullptr);
+    pthread_mutex_unlock(&inst->publish_lock);
+}
+
+/* Audio thread: perform a pending slot switch. The rig is announced in
+ * rig_in_use before use and the slot re-checked afterwards, so a rig the
+ * control thread is replacing is never picked up after it has been freed.
+ * A request that moves to another rig parks the one it leaves in fade_rig
+ * first, so its cab can be faded out (the manual cab needs no such care
+ * until service_update replaces it); fade_rig holds one rig, so a fade
+ * still running ends there. A request for the rig already playing - e.g.
+ * the manual rig, re-selected by every manual cab change - leaves a
+ * running fade alone. */
+static void service_slot_request(nam_instance_t *inst) {
+    /* Plain load first: no read-modify-write on the control thread's line
+     * when nothing is pending */
+    if (inst->slot_request.load(std::memory_order_relaxed) == SLOT_REQ_NONE) return;
+    int req = inst->slot_request.exchange(SLOT_REQ_NONE, std::memory_order_acq_rel);
+    if (req == SLOT_REQ_NONE) return;
+
+    nam_rig_t *prev = inst->slot_rig;
+    const nam_cab_t *prev_cab = prev ? prev->cab : inst->cab;
+    const bool valid = req >= 0 && req < MAX_SLOTS;
+    const bool moving = (valid ? inst->slots[req].load(std::memory_order_seq_cst) : nullptr) != prev;
+    if (moving) {
+        end_cab_fade(inst);
+        inst->fade_rig.store(prev, std::memory_order_seq_cst);
+    }
+
+    nam_rig_t *rig = nullptr;
+    if (valid) {
+        do {
+            rig = inst->slots[req].load(std::memory_order_seq_cst);
+            inst->rig_in_use.store(rig, std::memory_order_seq_cst);
+        } while (inst->slots[req].load(std::memory_order_seq_cst) != rig);
+    } else {
+        inst->rig_in_use.store(nullptr, std::memory_order_seq_cst);
+    }
+
+    inst->slot_rig = rig;
+    const nam_cab_t *cab = rig ? rig->cab : inst->cab;
+    if (moving) {
+        /* A re-select of what is already playing (e.g. a cab change on the
+         * manual rig) keeps a watchdog fallback in place */
+        watchdog_reset(inst);
+        if (prev_cab && cab && cab != prev_cab) start_cab_fade(inst, prev_cab);
+        else inst->fade_rig.store(nullptr, std::memory_order_seq_cst);
+    }
+    /* A rig that starts playing brings its levels; a re-select of the
+     * playing one keeps the gains a CC may have set */
+    if (moving) {
+        inst->tgt_input_gain = rig ? rig->input_gain : inst->live.input_gain;
+        inst->tgt_output_gain = rig ? rig->output_gain : inst->live.output_gain;
+    }
+    if (rig) {
+        inst->cur_cab_bypass = rig->cab_bypass;
+        inst->active_slot.store(req, std::memory_order_release);
+    } else {
+        inst->cur_cab_bypass = inst->live.cab_bypass;
+        inst->active_slot.store(-1, std::memory_order_release);
+    }
+}
+
+/* ======================================================================== */
+/* Background loading                                                        */
+/* ======================================================================== */
+
+/* All file I/O and model construction runs on a small per-instance worker
+ * pool. A load request is a transaction of up to two jobs - model and cab -
+ * that run concurrently on different workers; whichever finishes last
+ * publishes the result. For the manual rig that is a single nam_update_t,
+ * so a model+cab change reaches the audio thread at one block boundary.
+ * For a slot it is a complete rig. */
+
+static void discard_txn(load_txn_t *txn) {
+    delete txn->model;
+    free_cab(txn->cab);
+    free(txn->rig);
+    delete txn;
+}
+
+static void free_update(nam_update_t *u) {
+    if (!u) return;
+    delete u->model;
+    free_cab(u->cab);
+    free(u);
+}
+
+/* Free whatever the audio thread has handed back. Caller holds publish_lock. */
+static void reap_updates(nam_instance_t *inst) {
+    uint32_t tail = inst->retire_tail.load(std::memory_order_relaxed);
+    const uint32_t head = inst->retire_head.load(std::memory_order_acquire);
+    for (; tail != head; tail++) {
+        free_update(inst->retire_queue[tail & (RETIRE_QUEUE_SIZE - 1)]);
+    }
+    inst->retire_tail.store(tail, std::memory_order_release);
+}
+
+/* Publish a manual rig update. If the audio thread has not picked up the
+ * previous one yet, fold it in: parts the new update does not carry are
+ * taken over, parts it replaces are freed without ever having played.
+ * Caller holds publish_lock. */
+static void publish_update(nam_instance_t *inst, nam_update_t *u) {
+    nam_update_t *old = inst->pending_update.exchange(nullptr, std::memory_order_acq_rel);
+    if (old) {
+        if (!u->has_model && old->has_model) {
+            u->has_model = true;
+            u->model = old->model;
+            old->model = nullptr;
+        }
+        if (!u->has_cab && old->has_cab) {
+            u->has_cab = true;
+            u->cab = old->cab;
+            old->cab = nullptr;
+        }
+        free_update(old);
+    }
+    inst->pending_update.store(u, std::memory_order_release);
+}
+
+/* Audio thread: apply a published update by swapping pointers. A cab
+ * swapped out while it plays - or while a slot switch fades from it - is
+ * kept alive by holding on to the update until the fade is over. */
+static void service_update(nam_instance_t *inst) {
+    if (!inst->pending_update.load(std::memory_order_relaxed)) return;
+    nam_update_t *u = inst->pending_update.exchange(nullptr, std::memory_order_acq_rel);
+    if (!u) return;
+
+    if (u->has_model) {
+        std::swap(inst->model, u->model);
+        watchdog_reset(inst);
+    }
+    if (u->has_cab) {
+        std::swap(inst->cab, u->cab);
+        if (u->cab && u->cab == inst->fade_cab && !inst->fade_update) {
+            inst->fade_update = u;
+            return;
+        }
+        if (u->cab && inst->cab && !inst->slot_rig) {
+            end_cab_fade(inst);
+            inst->fade_update = u;
+            start_cab_fade(inst, u->cab);
+            return;
+        }
+    }
+    retire_update(inst, u);
+}
+
+/* Last job of a transaction done: publish what it produced */
+static void finish_txn(load_txn_t *txn) {
+    nam_instance_t *inst = txn->inst;
+    char msg[MAX_PATH_LEN + 64];
+
+    if (txn->slot >= 0) {
+        nam_rig_t *rig = txn->rig;
+        txn->rig = nullptr;
+        rig->model = txn->model;
+        rig->cab = txn->cab;
+        txn->model = nullptr;
+        txn->cab = nullptr;
+
+        if (rig->model) {
+            pthread_mutex_lock(&inst->publish_lock);
+            publish_slot(inst, txn->slot, rig);
+            pthread_mutex_unlock(&inst->publish_lock);
+
+            /* A restored state may be waiting for this slot to become active */
+            int want = txn->slot;
+            if (inst->deferred_slot.compare_exchange_strong(want, -1, std::memory_order_acq_rel)) {
+                inst->slot_request.store(txn->slot, std::memory_order_release);
+            }
+            snprintf(msg, sizeof(msg), "NAM: slot %d ready", txn->slot + 1);
+        } else {
+            free_rig(rig);
+            snprintf(msg, sizeof(msg), "NAM: failed to load slot %d", txn->slot + 1);
+        }
+        plugin_log(msg);
+        inst->slot_loads.fetch_sub(1, std::memory_order_acq_rel);
+        discard_txn(txn);
+        return;
+    }
+
+    /* Manual rig. A part superseded by a newer request, or that failed to
+     * load, is dropped; the audio thread keeps what it has for that part. */
+    bool counted_model = txn->want_model;
+    if (txn->want_model &&
+        (!txn->model || txn->model_gen != inst->model_gen.load(std::memory_order_acquire))) {
+        txn->want_model = false;
+    }
+    if (txn->want_cab &&
+        ((txn->cab_path[0] && !txn->cab) ||
+         txn->cab_gen != inst->cab_gen.load(std::memory_order_acquire))) {
+        txn->want_cab = false;
+    }
+
+    if (txn->want_model || txn->want_cab) {
+        nam_update_t *u = (nam_update_t *)calloc(1, sizeof(nam_update_t));
+        if (u) {
+            if (txn->want_model) {
+                u->has_model = true;
+                u->model = txn->model;
+                txn->model = nullptr;
+            }
+            if (txn->want_cab) {
+                u->has_cab = true;
+                u->cab = txn->cab;
+                inst->cab_fit_error.store(txn->cab ? txn->cab->lite.error_db : -1.0f,
+                                          std::memory_order_relaxed);
+                inst->cab_half_error.store(txn->cab ? txn->cab->half_error_db : 0.0f,
+                                           std::memory_order_relaxed);
+                txn->cab = nullptr;
+            }
+            pthread_mutex_lock(&inst->publish_lock);
+            publish_update(inst, u);
+            reap_updates(inst);
+            pthread_mutex_unlock(&inst->publish_lock);
+        }
+    }
+
+    if (counted_model) inst->model_loads.fetch_sub(1, std::memory_order_acq_rel);
+    discard_txn(txn);
+}
+
+/* Cab bank: every catalog cab, preloaded plain (single, flat EQ) by idle
+ * loader threads, so browsing cabs needs no I/O. One bank serves every
+ * instance on the same module folder with the same cab format, and any of
+ * their loaders fill it; it is reference counted and freed with the last
+ * of them. It keeps its own copy of the catalog paths, taken when it is
+ * created, so a rescan neither races with the loaders nor shifts which cab
+ * an entry holds. Entries are claimed through next; bytes and full are
+ * guarded by lock. */
+typedef struct cab_bank {
+    struct cab_bank *link;              /* g_banks list */
+    int refs;                           /* instances using it, under g_banks_lock */
+    char dir[MAX_PATH_LEN];             /* module_dir it was scanned from */
+    bool half;                          /* cab format: fp16 spectra ... */
+    int lock_memory;                    /* ... and memory locking */
+    size_t budget;                      /* bytes, from the instance that created it */
+    pthread_mutex_t lock;
+    size_t bytes;
+    bool full;                          /* a cab did not fit, preloading ended */
+    std::atomic<int> next;              /* next entry to load, may run past end */
+    int end;                            /* entries in paths, fixed at creation */
+    std::atomic<int> count;             /* cabs in the bank */
+    std::atomic<nam_cab_t *> cabs[MAX_CABS];  /* cabs[i] is paths[i] */
+    char paths[MAX_CABS][MAX_PATH_LEN];
+} cab_bank_t;
+
+static pthread_mutex_t g_banks_lock = PTHREAD_MUTEX_INITIALIZER;
+static cab_bank_t *g_banks;
+
+static bool bank_pending(const cab_bank_t *bank) {
+    return bank && bank->next.load(std::memory_order_relaxed) < bank->end;
+}
+
+/* The bank's copy of a plain cab (no second cab, flat EQ), or nullptr */
+static nam_cab_t *bank_lookup(nam_instance_t *inst, const char *cab_path, const char *cab2_path,
+                              const cab_eq_t *eq) {
+    cab_bank_t *bank = inst->bank;
+    if (!bank || cab2_path[0] || !eq_is_flat(eq)) return nullptr;
+    for (int i = 0; i < bank->end; i++) {
+        nam_cab_t *cab = bank->cabs[i].load(std::memory_order_acquire);
+        if (cab && strcmp(bank->paths[i], cab_path) == 0) return cab;
+    }
+    return nullptr;
+}
+
+/* Idle loader work: add bank entry idx to the bank, unless that would go
+ * over the budget, which ends preloading */
+static void bank_load(cab_bank_t *bank, int idx) {
+    nam_cab_t *cab = load_cab(bank->paths[idx], nullptr, 0.0f, nullptr, bank->half, bank->lock_memory);
+    if (!cab) return;
+    cab->banked = true;
+
+    pthread_mutex_lock(&bank->lock);
+    const size_t bytes = cab_bytes(cab);
+    const bool fits = !bank->full && bank->bytes + bytes <= bank->budget;
+    const bool first_miss = !fits && !bank->full;
+    if (fits) {
+        bank->bytes += bytes;
+    } else {
+        bank->full = true;
+        bank->next.store(bank->end, std::memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&bank->lock);
+
+    if (!fits) {
+        destroy_cab(cab);
+        if (!first_miss) return;
+        char msg[96];
+        snprintf(msg, sizeof(msg), "NAM: cab bank full at %d cabs",
+                 bank->count.load(std::memory_order_relaxed));
+        plugin_log(msg);
+        return;
+    }
+    bank->cabs[idx].store(cab, std::memory_order_release);
+    bank->count.fetch_add(1, std::memory_order_relaxed);
+}
+
+/* Drop an instance's reference; the last one frees the bank. Its loaders
+ * must have stopped. */
+static void release_cab_bank(cab_bank_t *bank) {
+    if (!bank) return;
+    pthread_mutex_lock(&g_banks_lock);
+    const bool last = --bank->refs == 0;
+    if (last) {
+        for (cab_bank_t **p = &g_banks; *p; p = &(*p)->link) {
+            if (*p == bank) {
+                *p = bank->link;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_banks_lock);
+    if (!last) return;
+
+    for (int i = 0; i < bank->end; i++) destroy_cab(bank->cabs[i].load(std::memory_order_acquire));
+    pthread_mutex_destroy(&bank->lock);
+    delete bank;
+}
+
+static void run_job(load_job_t job) {
+    load_txn_t *txn = job.txn;
+    char msg[MAX_PATH_LEN + 64];
+
+    if (job.is_model) {
+        snprintf(msg, sizeof(msg), "NAM: loading model %s", txn->model_path);
+        plugin_log(msg);
+
+        prefetch_model_file(txn->model_path);
+        txn->model = NeuralAudio::NeuralModel::CreateFromFile(txn->model_path);
+        if (txn->model) {
+            /* Warm-up reads every weight, which also prefaults them */
+            warm_up_model(txn->model);
+            /* The weights are NeuralAudio allocations the plugin cannot
+             * address, so locking them means locking the whole process */
+            if (txn->inst->lock_memory == MEMLOCK_ALL && mlockall(MCL_CURRENT) != 0) {
+                plugin_log("NAM: mlockall failed, model memory left unlocked");
+            }
+            snprintf(msg, sizeof(msg), "NAM: model loaded successfully (sample_rate=%.0f)",
+                     txn->model->GetSampleRate());
+        } else {
+            snprintf(msg, sizeof(msg), "NAM: failed to load model %s", txn->model_path);
+        }
+        plugin_log(msg);
+    } else if (txn->cab_path[0] &&
+               (txn->slot >= 0 || txn->cab_gen == txn->inst->cab_gen.load(std::memory_order_acquire))) {
+        /* A manual cab already superseded (e.g. by a blend sweep) is
+         * skipped; a plain catalog cab comes from the bank if it is there */
+        txn->cab = bank_lookup(txn->inst, txn->cab_path, txn->cab2_path, &txn->eq);
+        if (!txn->cab) {
+            txn->cab = load_cab(txn->cab_path, txn->cab2_path, txn->cab_blend, &txn->eq,
+                                txn->inst->cab_half, txn->inst->lock_memory);
+        }
+    }
+
+    if (txn->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) finish_txn(txn);
+}
+
+/* Parse "auto" or a CPU list like "2,3" / "1-3" into a mask (0 = auto).
+ * Returns false if the string is not a valid list. */
+static bool parse_cpu_list(const char *str, uint64_t *mask) {
+    if (strcmp(str, "auto") == 0 || str[0] == '\0') {
+        *mask = 0;
+        return true;
+    }
+    uint64_t m = 0;
+    const char *p = str;
+    while (*p) {
+        char *end;
+        long lo = strtol(p, &end, 10);
+        if (end == p) return false;
+        long hi = lo;
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+            if (end == p) return false;
+        }
+        if (lo < 0 || hi < lo || hi >= MAX_LOADER_CPUS) return false;
+        for (long c = lo; c <= hi; c++) m |= 1ull << c;
+        p = end;
+        if (*p == ',') p++;
+        else if (*p) return false;
+    }
+    *mask = m;
+    return m != 0;
+}
+
+static int format_cpu_list(uint64_t mask, char *buf, int buf_len) {
+    if (mask == 0) return snprintf(buf, buf_len, "auto");
+    int written = 0;
+    for (int c = 0; c < MAX_LOADER_CPUS && written < buf_len; c++) {
+        if (mask & (1ull << c)) {
+            written += snprintf(buf + written, buf_len - written, "%s%d", written ? "," : "", c);
+        }
+    }
+    return written;
+}
+
+static const char *k_loader_policy_names[] = { "idle", "batch", "normal" };
+
+/* Process-wide locked memory (VmLck), in bytes */
+static long locked_bytes(void) {
+    FILE *f = fopen("/proc/self/status", "r");
+    if (!f) return -1;
+    char line[128];
+    long kb = -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "VmLck: %ld kB", &kb) == 1) break;
+    }
+    fclose(f);
+    return kb < 0 ? -1 : kb * 1024;
+}
+
+/* Apply the configured policy and CPU set to the calling loader thread, so
+ * heavy model parsing stays off the audio thread's core and yields to it.
+ * Failures (no permission, CPU offline) leave the thread as it was. */
+static void apply_loader_sched(nam_instance_t *inst) {
+    struct sched_param sp = {};
+    int policy = inst->loader_policy.load(std::memory_order_acquire);
+    int sched = policy == LOADER_POLICY_IDLE ? SCHED_IDLE
+              : policy == LOADER_POLICY_BATCH ? SCHED_BATCH : SCHED_OTHER;
+    int nice_val = policy == LOADER_POLICY_NORMAL ? 0 : (policy == LOADER_POLICY_BATCH ? 10 : 19);
+    pthread_setschedparam(pthread_self(), sched, &sp);
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), nice_val);
+
+    uint64_t mask = inst->loader_cpu_mask.load(std::memory_order_acquire);
+    if (mask == 0) {
+        int audio_cpu = inst->audio_cpu.load(std::memory_order_relaxed);
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        if (audio_cpu < 0 || ncpu <= 1) return;
+        for (long c = 0; c < ncpu && c < MAX_LOADER_CPUS; c++) {
+            if (c != audio_cpu) mask |= 1ull << c;
+        }
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c = 0; c < MAX_LOADER_CPUS; c++) {
+        if (mask & (1ull << c)) CPU_SET(c, &set);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static void *loader_thread(void *arg) {
+    nam_instance_t *inst = (nam_instance_t *)arg;
+    uint32_t sched_gen = ~0u;
+
+    /* The first loader in the process calibrates the convolvers, with the
+     * loader scheduling already applied; the others go straight to work */
+    if (!g_conv.started.exchange(true, std::memory_order_acq_rel)) {
+        sched_gen = inst->loader_sched_gen.load(std::memory_order_acquire);
+        apply_loader_sched(inst);
+        conv_calibrate();
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&inst->loader_lock);
+        bool rebuild_due = false;
+        while (!inst->loader_quit && inst->loader_head == inst->loader_tail) {
+            rebuild_due = inst->rebuild_txn && monotonic_ns() >= inst->rebuild_due_ns;
+            if (rebuild_due || bank_pending(inst->bank)) break;
+            if (inst->rebuild_txn) {
+                struct timespec ts;
+                ts.tv_sec = (time_t)(inst->rebuild_due_ns / 1000000000ull);
+                ts.tv_nsec = (long)(inst->rebuild_due_ns % 1000000000ull);
+                pthread_cond_timedwait(&inst->loader_cond, &inst->loader_lock, &ts);
+            } else {
+                pthread_cond_wait(&inst->loader_cond, &inst->loader_lock);
+            }
+        }
+        if (inst->loader_quit) {
+            pthread_mutex_unlock(&inst->loader_lock);
+            break;
+        }
+        /* Requested loads first, then a settled cab rebuild; the bank fills
+         * in when there are none */
+        load_job_t job = {};
+        int bank_idx = -1;
+        if (inst->loader_head != inst->loader_tail) {
+            job = inst->loader_queue[inst->loader_tail++ & (LOADER_QUEUE_SIZE - 1)];
+        } else if (rebuild_due) {
+            job = { inst->rebuild_txn, false };
+            inst->rebuild_txn = nullptr;
+            job.txn->cab_gen = inst->cab_gen.fetch_add(1, std::memory_order_acq_rel) + 1;
+        } else {
+            bank_idx = inst->bank->next.fetch_add(1, std::memory_order_relaxed);
+        }
+        pthread_mutex_unlock(&inst->loader_lock);
+        if (!job.txn && bank_idx >= inst->bank->end) continue;  /* another loader took the last */
+
+        uint32_t gen = inst->loader_sched_gen.load(std::memory_order_acquire);
+        if (gen != sched_gen) {
+            sched_gen = gen;
+            apply_loader_sched(inst);
+        }
+
+        inst->loader_busy.fetch_add(1, std::memory_order_relaxed);
+        if (bank_idx >= 0) bank_load(inst->bank, bank_idx);
+        else run_job(job);
+        inst->loader_busy.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return nullptr;
+}
+
+static void start_loader_pool(nam_instance_t *inst) {
+    /* Timed waits (cab rebuilds) are against monotonic_ns() */
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&inst->loader_lock, nullptr);
+    pthread_cond_init(&inst->loader_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    inst->loader_head = inst->loader_tail = 0;
+    inst->loader_quit = false;
+    inst->rebuild_txn = nullptr;
+    inst->loader_thread_count = 0;
+    for (int i = 0; i < LOADER_THREADS; i++) {
+        if (pthread_create(&inst->loader_threads[i], nullptr, loader_thread, inst) == 0) {
+            inst->loader_thread_count++;
+        }
+    }
+}
+
+/* Stop the workers (a job already running is finished first) and drop any
+ * queued jobs without publishing them */
+static void stop_loader_pool(nam_instance_t *inst) {
+    pthread_mutex_lock(&inst->loader_lock);
+    inst->loader_quit = true;
+    pthread_cond_broadcast(&inst->loader_cond);
+    pthread_mutex_unlock(&inst->loader_lock);
+
+    for (int i = 0; i < inst->loader_thread_count; i++) {
+        pthread_join(inst->loader_threads[i], nullptr);
+    }
+
+    while (inst->loader_tail != inst->loader_head) {
+        load_txn_t *txn = inst->loader_queue[inst->loader_tail++ & (LOADER_QUEUE_SIZE - 1)].txn;
+        if (txn->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) discard_txn(txn);
+    }
+    if (inst->rebuild_txn) discard_txn(inst->rebuild_txn);
+    inst->rebuild_txn = nullptr;
+
+    pthread_cond_destroy(&inst->loader_cond);
+    pthread_mutex_destroy(&inst->loader_lock);
+}
+
+/* Join the bank for this instance's module folder and cab format, or
+ * create it from the scanned catalog, and let the loaders help fill it.
+ * Runs once per instance, before any lookup. */
+static void start_cab_bank(nam_instance_t *inst) {
+    if (inst->bank_budget == 0) return;
+
+    pthread_mutex_lock(&g_banks_lock);
+    cab_bank_t *bank = g_banks;
+    while (bank && (strcmp(bank->dir, inst->module_dir) != 0 || bank->half != inst->cab_half ||
+                    bank->lock_memory != inst->lock_memory)) {
+        bank = bank->link;
+    }
+    if (!bank) {
+        bank = new cab_bank_t();
+        snprintf(bank->dir, MAX_PATH_LEN, "%s", inst->module_dir);
+        bank->half = inst->cab_half;
+        bank->lock_memory = inst->lock_memory;
+        bank->budget = inst->bank_budget;
+        pthread_mutex_init(&bank->lock, nullptr);
+        for (int i = 0; i < inst->cab_count; i++) {
+            snprintf(bank->paths[i], MAX_PATH_LEN, "%s", inst->cab_paths[i]);
+        }
+        bank->end = inst->cab_count;
+        bank->link = g_banks;
+        g_banks = bank;
+    }
+    bank->refs++;
+    pthread_mutex_unlock(&g_banks_lock);
+
+    pthread_mutex_lock(&inst->loader_lock);
+    inst->bank = bank;
+    pthread_cond_broadcast(&inst->loader_cond);
+    pthread_mutex_unlock(&inst->loader_lock);
+}
+
+/* Queue a transaction's jobs. With no workers or a full queue the job runs
+ * on the calling thread instead. */
+static void submit_txn(nam_instance_t *inst, load_txn_t *txn) {
+    load_job_t jobs[2];
+    int n = 0;
+    if (txn->want_model) jobs[n++] = { txn, true };
+    if (txn->want_cab) jobs[n++] = { txn, false };
+    if (n == 0) {
+        discard_txn(txn);
+        return;
+    }
+    txn->remaining.store(n, std::memory_order_release);
+
+    for (int i = 0; i < n; i++) {
+        bool queued = false;
+        pthread_mutex_lock(&inst->loader_lock);
+        if (inst->loader_thread_count > 0 &&
+            inst->loader_head - inst->loader_tail < LOADER_QUEUE_SIZE) {
+            inst->loader_queue[inst->loader_head++ & (LOADER_QUEUE_SIZE - 1)] = jobs[i];
+            pthread_cond_signal(&inst->loader_cond);
+            queued = true;
+        }
+        pthread_mutex_unlock(&inst->loader_lock);
+        if (!queued) run_job(jobs[i]);
+    }
+}
+
+/* Path of the currently selected cab, or "" */
+static const char *current_cab_path(nam_instance_t *inst) {
+    int idx = inst->current_cab_index;
+    return (idx >= 0 && idx < inst->cab_count) ? inst->cab_paths[idx] : "";
+}
+
+/* Path of the second cab blended with it, or "" */
+static const char *current_cab2_path(nam_instance_t *inst) {
+    int idx = inst->current_cab2_index;
+    return (idx >= 0 && idx < inst->cab_count) ? inst->cab_paths[idx] : "";
+}
+
+/* Request a change to the manual rig. model_path nullptr keeps the model;
+ * cab_path nullptr keeps the cab and "" removes it. A cab loads paired
+ * with the current second cab, blend and EQ. Both parts load in parallel
+ * and are published together; a newer request for a part supersedes an
+ * older one still in flight. Control thread only. */
+static void request_manual_load(nam_instance_t *inst, const char *model_path,
+                                const char *cab_path) {
+    load_txn_t *txn = new load_txn_t();
+    txn->inst = inst;
+    txn->slot = -1;
+
+    if (model_path) {
+        txn->want_model = true;
+        strncpy(txn->model_path, model_path, MAX_PATH_LEN - 1);
+        txn->model_gen = inst->model_gen.fetch_add(1, std::memory_order_acq_rel) + 1;
+        inst->model_loads.fetch_add(1, std::memory_order_acq_rel);
+
+        memcpy(inst->model_path, txn->model_path, MAX_PATH_LEN);
+        path_to_name(model_path, inst->model_name, MAX_NAME_LEN);
+    }
+    if (cab_path) {
+        txn->want_cab = true;
+        strncpy(txn->cab_path, cab_path, MAX_PATH_LEN - 1);
+        if (cab_path[0]) strncpy(txn->cab2_path, current_cab2_path(inst), MAX_PATH_LEN - 1);
+        txn->cab_blend = inst->cab_blend;
+        txn->eq = inst->eq;
+
+        /* This load has everything a pending rebuild would, so it replaces it */
+        pthread_mutex_lock(&inst->loader_lock);
+        load_txn_t *rebuild = inst->rebuild_txn;
+        inst->rebuild_txn = nullptr;
+        txn->cab_gen = inst->cab_gen.fetch_add(1, std::memory_order_acq_rel) + 1;
+        pthread_mutex_unlock(&inst->loader_lock);
+        if (rebuild) discard_txn(rebuild);
+
+        /* A preloaded cab goes straight to the audio thread */
+        nam_cab_t *banked = cab_path[0] ? bank_lookup(inst, cab_path, txn->cab2_path, &txn->eq) : nullptr;
+        nam_update_t *u = banked ? (nam_update_t *)calloc(1, sizeof(nam_update_t)) : nullptr;
+        if (u) {
+            u->has_cab = true;
+            u->cab = banked;
+            inst->cab_fit_error.store(banked->lite.error_db, std::memory_order_relaxed);
+            inst->cab_half_error.store(banked->half_error_db, std::memory_order_relaxed);
+            pthread_mutex_lock(&inst->publish_lock);
+            publish_update(inst, u);
+            reap_updates(inst);
+            pthread_mutex_unlock(&inst->publish_lock);
+            txn->want_cab = false;
+        }
+
+        if (cab_path[0]) path_to_name(cab_path, inst->cab_name, MAX_NAME_LEN);
+        else inst->cab_name[0] = '\0';
+    }
+
+    submit_txn(inst, txn);
+}
+
+/* A dual cab plays a moving blend from both IRs' spectra, and EQ is
+ * baked into the IR. Once either has settled for CAB_REBUILD_DELAY_NS, a
+ * loader thread rebuilds the manual cab so it costs one plain IR again;
+ * each change pushes the rebuild back. Control thread only. */
+static void schedule_cab_rebuild(nam_instance_t *inst) {
+    const char *cab_path = current_cab_path(inst);
+    if (!cab_path[0]) return;
+
+    load_txn_t *txn = new load_txn_t();
+    txn->inst = inst;
+    txn->slot = -1;
+    txn->want_cab = true;
+    strncpy(txn->cab_path, cab_path, MAX_PATH_LEN - 1);
+    strncpy(txn->cab2_path, current_cab2_path(inst), MAX_PATH_LEN - 1);
+    txn->cab_blend = inst->cab_blend;
+    txn->eq = inst->eq;
+    txn->remaining.store(1, std::memory_order_relaxed);
+
+    pthread_mutex_lock(&inst->loader_lock);
+    load_txn_t *old = inst->rebuild_txn;
+    if (inst->loader_thread_count > 0) {
+        inst->rebuild_txn = txn;
+        inst->rebuild_due_ns = monotonic_ns() + CAB_REBUILD_DELAY_NS;
+        pthread_cond_signal(&inst->loader_cond);
+        txn = nullptr;
+    }
+    pthread_mutex_unlock(&inst->loader_lock);
+    if (old) discard_txn(old);
+    if (txn) discard_txn(txn);  /* no workers: the blend keeps playing live */
+}
+
+/* Load a rig into a slot in the background. The slot keeps playing its
+ * previous rig until the new one is ready. cab_path and cab2_path may be
+ * empty. Control thread only. */
+static void load_slot(nam_instance_t *inst, int slot, const char *model_path,
+                      const char *cab_path, const char *cab2_path, float cab_blend,
+                      const cab_eq_t *eq, float input_level, float output_level,
+                      bool cab_bypass) {
+    if (slot < 0 || slot >= MAX_SLOTS || !model_path || !model_path[0]) return;
+
+    nam_rig_t *rig = (nam_rig_t *)calloc(1, sizeof(nam_rig_t));
+    if (!rig) return;
+
+    strncpy(rig->model_path, model_path, MAX_PATH_LEN - 1);
+    path_to_name(model_path, rig->model_name, MAX_NAME_LEN);
+    if (cab_path && cab_path[0]) {
+        strncpy(rig->cab_path, cab_path, MAX_PATH_LEN - 1);
+        path_to_name(cab_path, rig->cab_name, MAX_NAME_LEN);
+        if (cab2_path && cab2_path[0]) {
+            strncpy(rig->cab2_path, cab2_path, MAX_PATH_LEN - 1);
+            path_to_name(cab2_path, rig->cab2_name, MAX_NAME_LEN);
+        }
+    }
+    rig->cab_blend = clampf(cab_blend, 0.0f, 1.0f);
+    rig->eq = *eq;
+    rig->input_level = input_level;
+    rig->output_level = output_level;
+    rig->input_gain = knob_to_gain(input_level);
+    rig->output_gain = knob_to_gain(output_level);
+    rig->cab_bypass = cab_bypass;
+
+    char msg[MAX_NAME_LEN + 64];
+    snprintf(msg, sizeof(msg), "NAM: loading slot %d (%s)", slot + 1, rig->model_name);
+    plugin_log(msg);
+
+    load_txn_t *txn = new load_txn_t();
+    txn->inst = inst;
+    txn->slot = slot;
+    txn->rig = rig;
+    txn->want_model = true;
+    memcpy(txn->model_path, rig->model_path, MAX_PATH_LEN);
+    txn->want_cab = rig->cab_path[0] != '\0';
+    memcpy(txn->cab_path, rig->cab_path, MAX_PATH_LEN);
+    memcpy(txn->cab2_path, rig->cab2_path, MAX_PATH_LEN);
+    txn->cab_blend = rig->cab_blend;
+    txn->eq = rig->eq;
+
+    inst->slot_loads.fetch_add(1, std::memory_order_acq_rel);
+    submit_txn(inst, txn);
+}
+
+/* Capture the current model/cab/levels into a slot */
+static void store_slot(nam_instance_t *inst, int slot) {
+    if (!inst->model_path[0]) {
+        plugin_log("NAM: no model to store in slot");
+        return;
+    }
+    load_slot(inst, slot, inst->model_path, current_cab_path(inst), current_cab2_path(inst),
+              inst->cab_blend, &inst->eq, inst->input_level, inst->output_level, inst->cab_bypass);
+}
+
+/* Bring the control-side levels in line with a slot the audio thread has
+ * switched to (possibly from a Program Change), and free rigs and updates
+ * it no longer holds. Called at the top of set_param; get_param only looks,
+ * through shown_levels. */
+static void sync_control_state(nam_instance_t *inst) {
+    pthread_mutex_lock(&inst->publish_lock);
+    reap_retired_rigs(inst);
+    reap_updates(inst);
+
+    int active = inst->active_slot.load(std::memory_order_acquire);
+    if (active != inst->seen_slot) {
+        inst->seen_slot = active;
+        nam_rig_t *rig = active >= 0 ? inst->slots[active].load(std::memory_order_acquire) : nullptr;
+        if (rig) {
+            inst->input_level = rig->input_level;
+            inst->output_level = rig->output_level;
+            inst->cab_bypass = rig->cab_bypass;
+            publish_params(inst);
+        }
+    }
+    pthread_mutex_unlock(&inst->publish_lock);
+}
+
+/* The levels get_param reports: those of a slot the audio thread has
+ * switched to since the last sync, else the control-side ones. */
+typedef struct {
+    float input_level;
+    float output_level;
+    bool cab_bypass;
+} shown_levels_t;
+
+static shown_levels_t shown_levels(nam_instance_t *inst) {
+    shown_levels_t lv = { inst->input_level, inst->output_level, inst->cab_bypass };
+    pthread_mutex_lock(&inst->publish_lock);
+    int active = inst->active_slot.load(std::memory_order_acquire);
+    if (active != inst->seen_slot && active >= 0) {
+        const nam_rig_t *rig = inst->slots[active].load(std::memory_order_acquire);
+        if (rig) lv = { rig->input_level, rig->output_level, rig->cab_bypass };
+    }
+    pthread_mutex_unlock(&inst->publish_lock);
+    return lv;
+}
+
+/* ======================================================================== */
+/* MIDI control                                                              */
+/* ======================================================================== */
+
+/* Default CC for the output level - 11 (expression) is what most pedals send */
+#define DEFAULT_OUTPUT_CC 11
+
+/* Route a CC number to a target, or unmap the target with cc < 0.
+ * A CC drives at most one target. Control thread only. */
+static void set_midi_cc(nam_instance_t *inst, int target, int cc) {
+    int old = inst->target_cc[target];
+    if (old >= 0) inst->cc_map[old].store(MIDI_TARGET_NONE, std::memory_order_relaxed);
+    inst->target_cc[target] = -1;
+    if (cc < 0 || cc > 127) return;
+
+    int prev_target = inst->cc_map[cc].load(std::memory_order_relaxed);
+    if (prev_target != MIDI_TARGET_NONE) inst->target_cc[prev_target] = -1;
+    inst->cc_map[cc].store((uint8_t)target, std::memory_order_relaxed);
+    inst->target_cc[target] = cc;
+}
+
+/* Build this block's per-sample input/output gain curves. Queued CC events
+ * are placed at the sample offset matching their arrival time within the
+ * previous block period - one block of latency but no timing jitter - and
+ * the gain ramps from breakpoint to breakpoint so pedal sweeps stay smooth.
+ * Without events this is the plain one-block ramp to the set_param target. */
+static void build_gain_curves(nam_instance_t *inst, int n, uint64_t now) {
+    float *curve[MIDI_TARGET_COUNT] = { nullptr, inst->in_gain, inst->out_gain };
+    float *cur[MIDI_TARGET_COUNT] = { nullptr, &inst->cur_input_gain, &inst->cur_output_gain };
+    float *tgt[MIDI_TARGET_COUNT] = { nullptr, &inst->tgt_input_gain, &inst->tgt_output_gain };
+    int pos[MIDI_TARGET_COUNT] = { 0, 0, 0 };
+
+    const uint64_t last = inst->last_block_ns;
+    const uint64_t span = (last && now > last) ? now - last : 0;
+
+    uint32_t tail = inst->midi_tail.load(std::memory_order_relaxed);
+    const uint32_t head = inst->midi_head.load(std::memory_order_acquire);
+    for (; tail != head; tail++) {
+        const midi_event_t *ev = &inst->midi_queue[tail & (MIDI_QUEUE_SIZE - 1)];
+        int t = ev->target;
+        if (t <= MIDI_TARGET_NONE || t >= MIDI_TARGET_COUNT) continue;
+
+        int off = 0;
+        if (span && ev->time_ns > last) {
+            off = (int)((ev->time_ns - last) * (uint64_t)n / span);
+            if (off > n - 1) off = n - 1;
+        }
+        if (off < pos[t]) off = pos[t];
+
+        if (off < n) {
+            float from = pos[t] ? curve[t][pos[t] - 1] : *cur[t];
+            fill_ramp(curve[t], pos[t], off + 1, from, ev->gain);
+            pos[t] = off + 1;
+        }
+        *tgt[t] = ev->gain;
+    }
+    inst->midi_tail.store(tail, std::memory_order_release);
+
+    for (int t = MIDI_TARGET_INPUT; t < MIDI_TARGET_COUNT; t++) {
+        float from = pos[t] ? curve[t][pos[t] - 1] : *cur[t];
+        fill_ramp(curve[t], pos[t], n, from, *tgt[t]);
+        *cur[t] = *tgt[t];
+    }
+    inst->last_block_ns = now;
+}
+
+/* ======================================================================== */
+/* CPU budget                                                                */
+/* ======================================================================== */
+
+/* All instances in the process share one budget: each publishes its smoothed
+ * block cost in a g_budget share, and when the sum nears the block deadline
+ * every instance steps down to a cheaper quality level together, stepping
+ * back up once there is headroom again. Down is quick and up is slow, with
+ * a gap between the two thresholds, and a step up that has to be undone
+ * soon after doubles the wait before the next one, so the level settles
+ * instead of oscillating.
+ *
+ * A share only counts while its instance keeps refreshing it, so one that
+ * is bypassed or no longer processed stops holding budget within a few
+ * checks, without anything having to run on its behalf.
+ *
+ * The plugin-side cost that can be traded is the cab convolution, so the
+ * levels cap the number of IR taps used. */
+#define BUDGET_HIGH_PCT 80          /* step down above this share of the deadline */
+#define BUDGET_LOW_PCT 50           /* step up below it */
+#define BUDGET_DOWN_HOLD_MS 50
+#define BUDGET_UP_HOLD_MS 2000
+#define BUDGET_MAX_BACKOFF 4        /* up hold at most 2 s << 4 = 32 s */
+#define BUDGET_CHECK_BLOCKS 16      /* per instance, between checks */
+#define BUDGET_STALE_CHECKS 4       /* shares not refreshed in this many checks are ignored */
+#define BUDGET_MAX_SHARES 32        /* instances beyond this are not budgeted */
+#define BUDGET_LEVELS 4
+
+static const int k_budget_ir_taps[BUDGET_LEVELS] = { MAX_IR_LEN, 2048, 512, 128 };
+
+typedef struct {
+    alignas(CACHE_LINE) std::atomic<bool> used;
+    std::atomic<uint32_t> cost_ns;        /* owner's smoothed block cost */
+    std::atomic<uint64_t> stamp_ns;       /* when the owner last refreshed it */
+} budget_share_t;
+
+static struct {
+    budget_share_t shares[BUDGET_MAX_SHARES];
+    std::atomic<int> level;               /* 0 = full quality */
+    std::atomic<uint64_t> last_change_ns;
+    std::atomic<int> backoff;             /* up hold = BUDGET_UP_HOLD_MS << backoff */
+    std::atomic<bool> last_was_up;
+    std::atomic<int> instances;
+} g_budget;
+
+/* Sum of the shares refreshed recently enough to count */
+static uint64_t budget_total(uint64_t now, uint64_t deadline) {
+    const uint64_t stale_ns = deadline * BUDGET_CHECK_BLOCKS * BUDGET_STALE_CHECKS;
+    uint64_t total = 0;
+    for (int i = 0; i < BUDGET_MAX_SHARES; i++) {
+        const budget_share_t *sh = &g_budget.shares[i];
+        if (!sh->used.load(std::memory_order_relaxed)) continue;
+        if (now - sh->stamp_ns.load(std::memory_order_relaxed) > stale_ns) continue;
+        total += sh->cost_ns.load(std::memory_order_relaxed);
+    }
+    return total;
 }
 
-/* Check if filename ends with .wav or .ir */
-static bool is_cab_file(const char *name) {
-    const char *dot = strrchr(name, '.');
-    if (!dot) return false;
-    return (strcasecmp(dot, ".wav") == 0 ||
-            strcasecmp(dot, ".ir") == 0);
+/* Control thread, when an instance is created */
+static void budget_add(nam_instance_t *inst) {
+    inst->budget_share = -1;
+    for (int i = 0; i < BUDGET_MAX_SHARES; i++) {
+        budget_share_t *sh = &g_budget.shares[i];
+        bool expected = false;
+        if (!sh->used.compare_exchange_strong(expected, true, std::memory_order_relaxed)) continue;
+        inst->budget_share = i;
+        break;
+    }
+    if (inst->budget_share < 0) plugin_log("NAM: budget shares full, instance not budgeted");
+    g_budget.instances.fetch_add(1, std::memory_order_relaxed);
 }
 
-/* Generic directory scanner - populates parallel name/path arrays.
- * Returns file count. */
-static int scan_directory(const char *dir_path,
-                          char names[][MAX_NAME_LEN],
-                          char paths[][MAX_PATH_LEN],
-                          int max_entries,
-                          bool (*filter)(const char *)) {
-    int count = 0;
-    DIR *dir = opendir(dir_path);
-    if (!dir) return 0;
+/* Audio thread, after each block */
+static void budget_account(nam_instance_t *inst, uint64_t elapsed, uint64_t deadline, uint32_t blocks) {
+    const uint32_t cost = (uint32_t)std::min<uint64_t>(elapsed, UINT32_MAX / 2);
+    inst->cost_ns = inst->cost_ns ? inst->cost_ns - inst->cost_ns / 16 + cost / 16 : cost;
+    if (blocks % BUDGET_CHECK_BLOCKS) return;
 
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != nullptr && count < max_entries) {
-        if (entry->d_name[0] == '.') continue;
-        if (!filter(entry->d_name)) continue;
+    const uint64_t now = monotonic_ns();
+    if (inst->budget_share >= 0) {
+        budget_share_t *sh = &g_budget.shares[inst->budget_share];
+        /* Back from a gap: the old average says nothing about this run */
+        if (now - sh->stamp_ns.load(std::memory_order_relaxed) > deadline * BUDGET_CHECK_BLOCKS * BUDGET_STALE_CHECKS)
+            inst->cost_ns = cost;
+        sh->cost_ns.store(inst->cost_ns, std::memory_order_relaxed);
+        sh->stamp_ns.store(now, std::memory_order_relaxed);
+    }
 
-        snprintf(paths[count], MAX_PATH_LEN, "%s/%s", dir_path, entry->d_name);
-        path_to_name(entry->d_name, names[count], MAX_NAME_LEN);
-        count++;
+    const uint64_t total = budget_total(now, deadline);
+    const int level = g_budget.level.load(std::memory_order_relaxed);
+    int next = level;
+    uint64_t hold_ms = 0;
+    if (total * 100 > deadline * BUDGET_HIGH_PCT && level < BUDGET_LEVELS - 1) {
+        next = level + 1;
+        hold_ms = BUDGET_DOWN_HOLD_MS;
+    } else if (total * 100 < deadline * BUDGET_LOW_PCT && level > 0) {
+        next = level - 1;
+        hold_ms = (uint64_t)BUDGET_UP_HOLD_MS << g_budget.backoff.load(std::memory_order_relaxed);
     }
-    closedir(dir);
+    if (next == level) return;
 
-    /* Sort alphabetically by name */
-    for (int i = 0; i < count - 1; i++) {
-        for (int j = i + 1; j < count; j++) {
-            if (strcasecmp(names[i], names[j]) > 0) {
-                char tmp_name[MAX_NAME_LEN], tmp_path[MAX_PATH_LEN];
-                memcpy(tmp_name, names[i], MAX_NAME_LEN);
-                memcpy(tmp_path, paths[i], MAX_PATH_LEN);
-                memcpy(names[i], names[j], MAX_NAME_LEN);
-                memcpy(paths[i], paths[j], MAX_PATH_LEN);
-                memcpy(names[j], tmp_name, MAX_NAME_LEN);
-                memcpy(paths[j], tmp_path, MAX_PATH_LEN);
-            }
-        }
+    /* One instance wins the change; the rest see the new level next block */
+    uint64_t last = g_budget.last_change_ns.load(std::memory_order_relaxed);
+    if (now - last < hold_ms * 1000000ull) return;
+    if (!g_budget.last_change_ns.compare_exchange_strong(last, now, std::memory_order_relaxed)) return;
+
+    const bool up = next < level;
+    const int backoff = g_budget.backoff.load(std::memory_order_relaxed);
+    if (!up && g_budget.last_was_up.load(std::memory_order_relaxed) &&
+        now - last < (uint64_t)BUDGET_UP_HOLD_MS * 1000000ull && backoff < BUDGET_MAX_BACKOFF) {
+        g_budget.backoff.store(backoff + 1, std::memory_order_relaxed);
+    } else if (up && next == 0) {
+        g_budget.backoff.store(0, std::memory_order_relaxed);
     }
+    g_budget.last_was_up.store(up, std::memory_order_relaxed);
+    g_budget.level.store(next, std::memory_order_relaxed);
+}
 
-    return count;
+/* Control thread, when an instance goes away */
+static void budget_remove(nam_instance_t *inst) {
+    if (inst->budget_share >= 0) {
+        budget_share_t *sh = &g_budget.shares[inst->budget_share];
+        sh->cost_ns.store(0, std::memory_order_relaxed);
+        sh->stamp_ns.store(0, std::memory_order_relaxed);
+        sh->used.store(false, std::memory_order_release);
+    }
+    g_budget.instances.fetch_sub(1, std::memory_order_relaxed);
 }
 
-/* Scan models directory and populate instance model list */
-static void scan_models(nam_instance_t *inst) {
-    char models_dir[MAX_PATH_LEN];
-    snprintf(models_dir, sizeof(models_dir), "%s/models", inst->module_dir);
+/* ======================================================================== */
+/* Instance state                                                            */
+/* ======================================================================== */
 
-    inst->model_count = scan_directory(models_dir,
-                                       inst->model_names, inst->model_paths,
-                                       MAX_MODELS, is_model_file);
+/* The whole instance - manual model/cab, levels, CC map, slot contents and
+ * active slot - as one compact JSON object, so a patch is recalled in a
+ * single set_param instead of a replay of individual keys. */
 
-    char msg[128];
-    snprintf(msg, sizeof(msg), "NAM: found %d model files", inst->model_count);
-    plugin_log(msg);
+/* Find a file in a scanned catalog: exact path first, then by display name
+ * so a state still resolves after the module directory moved. -1 if absent. */
+static int resolve_catalog(const char *path, char names[][MAX_NAME_LEN],
+                           char paths[][MAX_PATH_LEN], int count) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(paths[i], path) == 0) return i;
+    }
+    char name[MAX_NAME_LEN];
+    path_to_name(path, name, MAX_NAME_LEN);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(names[i], name) == 0) return i;
+    }
+    return -1;
 }
 
-/* Scan cabs directory and populate instance cab list */
-static void scan_cabs(nam_instance_t *inst) {
-    char cabs_dir[MAX_PATH_LEN];
-    snprintf(cabs_dir, sizeof(cabs_dir), "%s/cabs", inst->module_dir);
+static double round_level(float v) {
+    return std::round(v * 1000.0f) / 1000.0;
+}
 
-    inst->cab_count = scan_directory(cabs_dir,
-                                     inst->cab_names, inst->cab_paths,
-                                     MAX_CABS, is_cab_file);
+static int get_state(nam_instance_t *inst, char *buf, int buf_len) {
+    const shown_levels_t lv = shown_levels(inst);
+    nlohmann::json st;
+    st["model"] = inst->model_path;
+    st["cab"] = current_cab_path(inst);
+    st["cab2"] = current_cab2_path(inst);
+    st["cab_blend"] = round_level(inst->cab_blend);
+    st["eq"] = { inst->eq.bass, inst->eq.mid, inst->eq.treble };
+    st["input_level"] = round_level(lv.input_level);
+    st["output_level"] = round_level(lv.output_level);
+    st["cab_bypass"] = lv.cab_bypass ? 1 : 0;
+    st["cab_lite"] = inst->cab_lite ? 1 : 0;
+    st["midi_cc_input"] = inst->target_cc[MIDI_TARGET_INPUT];
+    st["midi_cc_output"] = inst->target_cc[MIDI_TARGET_OUTPUT];
+    st["slot"] = inst->active_slot.load(std::memory_order_acquire);
 
-    char msg[128];
-    snprintf(msg, sizeof(msg), "NAM: found %d cab IR files", inst->cab_count);
-    plugin_log(msg);
+    nlohmann::json slots = nlohmann::json::array();
+    pthread_mutex_lock(&inst->publish_lock);
+    for (int i = 0; i < MAX_SLOTS; i++) {
+        const nam_rig_t *rig = inst->slots[i].load(std::memory_order_acquire);
+        if (!rig) {
+            slots.push_back(nullptr);
+            continue;
+        }
+        slots.push_back({
+            { "model", rig->model_path },
+            { "cab", rig->cab_path },
+            { "cab2", rig->cab2_path },
+            { "cab_blend", round_level(rig->cab_blend) },
+            { "eq", { rig->eq.bass, rig->eq.mid, rig->eq.treble } },
+            { "input_level", round_level(rig->input_level) },
+            { "output_level", round_level(rig->output_level) },
+            { "cab_bypass", rig->cab_bypass ? 1 : 0 },
+        });
+    }
+    pthread_mutex_unlock(&inst->publish_lock);
+    st["slots"] = slots;
+
+    std::string out = st.dump();
+    return snprintf(buf, buf_len, "%s", out.c_str());
 }
 
-/* Load a cab IR from file, replacing any previously loaded IR */
-static void load_cab(nam_instance_t *inst, int index) {
-    if (index < 0 || index >= inst->cab_count) return;
+/* True if a loaded slot already holds exactly this rig */
+static bool slot_matches(nam_instance_t *inst, int slot, const char *model_path,
+                         const char *cab_path, const char *cab2_path, float blend,
+                         const cab_eq_t *eq, float in, float out, bool bypass) {
+    const nam_rig_t *rig = inst->slots[slot].load(std::memory_order_acquire);
+    return rig && strcmp(rig->model_path, model_path) == 0 &&
+           strcmp(rig->cab_path, cab_path) == 0 &&
+           strcmp(rig->cab2_path, cab2_path) == 0 && rig->cab_blend == blend &&
+           memcmp(&rig->eq, eq, sizeof(cab_eq_t)) == 0 &&
+           rig->input_level == in && rig->output_level == out &&
+           rig->cab_bypass == bypass;
+}
 
-    float *new_ir = (float *)calloc(MAX_IR_LEN, sizeof(float));
-    if (!new_ir) return;
+/* A state decoded from JSON, before anything is applied */
+typedef struct {
+    std::string model;
+    std::string cab;
+    std::string cab2;
+    float cab_blend;
+    cab_eq_t eq;
+    float input_level;
+    float output_level;
+    bool cab_bypass;
+    bool cab_lite;
+    int midi_cc_input;
+    int midi_cc_output;
+    int slot;
+    bool slot_used[MAX_SLOTS];
+    std::string slot_model[MAX_SLOTS];
+    std::string slot_cab[MAX_SLOTS];
+    std::string slot_cab2[MAX_SLOTS];
+    float slot_cab_blend[MAX_SLOTS];
+    cab_eq_t slot_eq[MAX_SLOTS];
+    float slot_input_level[MAX_SLOTS];
+    float slot_output_level[MAX_SLOTS];
+    bool slot_cab_bypass[MAX_SLOTS];
+} nam_state_t;
 
-    int ir_len = load_wav_ir(inst->cab_paths[index], new_ir, MAX_IR_LEN);
-    if (ir_len <= 0) {
-        free(new_ir);
-        char msg[MAX_PATH_LEN + 64];
-        snprintf(msg, sizeof(msg), "NAM: failed to load cab IR %s", inst->cab_paths[index]);
-        plugin_log(msg);
-        return;
+/* EQ as [bass, mid, treble] dB; missing = flat */
+static cab_eq_t parse_eq(const nlohmann::json &j) {
+    cab_eq_t eq = { 0.0f, 0.0f, 0.0f };
+    const nlohmann::json e = j.value("eq", nlohmann::json::array());
+    if (e.is_array() && e.size() == 3) {
+        eq.bass = clampf(e[0].get<float>(), -EQ_MAX_DB, EQ_MAX_DB);
+        eq.mid = clampf(e[1].get<float>(), -EQ_MAX_DB, EQ_MAX_DB);
+        eq.treble = clampf(e[2].get<float>(), -EQ_MAX_DB, EQ_MAX_DB);
     }
+    return eq;
+}
 
-    /* Replace old IR */
-    float *old_ir = inst->cab_ir;
-    float *old_hist = inst->cab_history;
-
-    inst->cab_ir = new_ir;
-    inst->cab_ir_len = ir_len;
-    inst->current_cab_index = index;
-    path_to_name(inst->cab_paths[index], inst->cab_name, MAX_NAME_LEN);
-
-    /* Allocate new history buffer for convolution */
-    inst->cab_history = (float *)calloc(ir_len + FRAMES_PER_BLOCK, sizeof(float));
-    inst->cab_hist_pos = 0;
+/* Decode the JSON side completely first, so a malformed or mistyped state
+ * changes nothing. Returns false on any error. */
+static bool parse_state(nam_instance_t *inst, const char *json, nam_state_t *st) {
+    try {
+        nlohmann::json j = nlohmann::json::parse(json);
+        if (!j.is_object()) return false;
 
-    free(old_ir);
-    free(old_hist);
+        st->model = j.value("model", std::string());
+        st->cab = j.value("cab", std::string());
+        st->cab2 = j.value("cab2", std::string());
+        st->cab_blend = clampf(j.value("cab_blend", inst->cab_blend), 0.0f, 1.0f);
+        st->eq = parse_eq(j);
+        st->input_level = clampf(j.value("input_level", inst->input_level), 0.0f, 1.0f);
+        st->output_level = clampf(j.value("output_level", inst->output_level), 0.0f, 1.0f);
+        st->cab_bypass = j.value("cab_bypass", 0) != 0;
+        st->cab_lite = j.value("cab_lite", 0) != 0;
+        st->midi_cc_input = j.value("midi_cc_input", -1);
+        st->midi_cc_output = j.value("midi_cc_output", DEFAULT_OUTPUT_CC);
+        st->slot = j.value("slot", -1);
 
-    char msg[MAX_PATH_LEN + 64];
-    snprintf(msg, sizeof(msg), "NAM: loaded cab IR '%s' (%d samples)", inst->cab_name, ir_len);
-    plugin_log(msg);
+        const nlohmann::json slots = j.value("slots", nlohmann::json::array());
+        for (int i = 0; i < MAX_SLOTS; i++) {
+            st->slot_used[i] = slots.is_array() && i < (int)slots.size() && slots[i].is_object();
+            if (!st->slot_used[i]) continue;
+            const nlohmann::json &e = slots[i];
+            st->slot_model[i] = e.value("model", std::string());
+            st->slot_cab[i] = e.value("cab", std::string());
+            st->slot_cab2[i] = e.value("cab2", std::string());
+            st->slot_cab_blend[i] = clampf(e.value("cab_blend", 0.5f), 0.0f, 1.0f);
+            st->slot_eq[i] = parse_eq(e);
+            st->slot_input_level[i] = clampf(e.value("input_level", 0.5f), 0.0f, 1.0f);
+            st->slot_output_level[i] = clampf(e.value("output_level", 0.5f), 0.0f, 1.0f);
+            st->slot_cab_bypass[i] = e.value("cab_bypass", 0) != 0;
+            if (st->slot_model[i].empty()) st->slot_used[i] = false;
+        }
+    } catch (const nlohmann::json::exception &) {
+        return false;
+    }
+    return true;
 }
 
-/* Apply cab IR convolution in-place using direct time-domain overlap-save.
- * Circular buffer avoids per-block allocation. */
-static void apply_cab_ir(nam_instance_t *inst, float *audio, int frames) {
-    if (!inst->cab_ir || inst->cab_ir_len <= 0 || !inst->cab_history) return;
+/* Restore a state produced by get_state in one transaction. Models and
+ * cabs are resolved through the scanned catalogs and the already-loaded
+ * slots; anything already in place is not reloaded. The manual model and
+ * cab load in parallel on the loader pool and reach the audio thread
+ * together; changed slots load alongside them. */
+static void restore_state(nam_instance_t *inst, const char *json) {
+    nam_state_t *st = new nam_state_t();
+    if (!parse_state(inst, json, st)) {
+        plugin_log("NAM: ignoring malformed state");
+        delete st;
+        return;
+    }
 
-    const float *ir = inst->cab_ir;
-    const int ir_len = inst->cab_ir_len;
-    float *hist = inst->cab_history;
-    const int hist_len = ir_len + FRAMES_PER_BLOCK;
-    int pos = inst->cab_hist_pos;
+    /* Manual model and cab - one transaction, started first */
+    const char *model_path = nullptr;
+    if (!st->model.empty()) {
+        int idx = resolve_catalog(st->model.c_str(), inst->model_names, inst->model_paths,
+                                  inst->model_count);
+        const char *path = idx >= 0 ? inst->model_paths[idx] : st->model.c_str();
+        inst->current_model_index = idx;
+        if (strcmp(path, inst->model_path) != 0) model_path = path;
+    }
+    const char *cab_path = nullptr;
+    int cab_idx = st->cab.empty() ? -1
+        : resolve_catalog(st->cab.c_str(), inst->cab_names, inst->cab_paths, inst->cab_count);
+    int cab2_idx = st->cab2.empty() ? -1
+        : resolve_catalog(st->cab2.c_str(), inst->cab_names, inst->cab_paths, inst->cab_count);
+    if (cab_idx != inst->current_cab_index || cab2_idx != inst->current_cab2_index ||
+        (cab2_idx >= 0 && st->cab_blend != inst->cab_blend) ||
+        (cab_idx >= 0 && memcmp(&st->eq, &inst->eq, sizeof(cab_eq_t)) != 0)) {
+        inst->current_cab_index = cab_idx;
+        inst->current_cab2_index = cab2_idx;
+        inst->cab_blend = st->cab_blend;
+        inst->eq = st->eq;
+        cab_path = cab_idx >= 0 ? inst->cab_paths[cab_idx] : "";
+    }
+    if (model_path || cab_path) request_manual_load(inst, model_path, cab_path);
 
-    for (int i = 0; i < frames; i++) {
-        /* Write input sample into circular history */
-        hist[pos] = audio[i];
+    /* Slots. The active slot, if it needs loading, is marked deferred before
+     * its loader starts so the loader can switch to it the moment it is ready. */
+    bool want_slot_ready = false;
+    inst->deferred_slot.store(-1, std::memory_order_release);
+    for (int i = 0; i < MAX_SLOTS; i++) {
+        if (!st->slot_used[i]) {
+            clear_slot(inst, i);
+            continue;
+        }
 
-        /* Convolve: sum of ir[k] * hist[pos-k] for k=0..ir_len-1 */
-        float sum = 0.0f;
-        int p = pos;
-        for (int k = 0; k < ir_len; k++) {
-            sum += ir[k] * hist[p];
-            if (--p < 0) p = hist_len - 1;
+        const char *m = st->slot_model[i].c_str();
+        const char *c = st->slot_cab[i].c_str();
+        const char *c2 = st->slot_cab2[i].c_str();
+        int mi = resolve_catalog(m, inst->model_names, inst->model_paths, inst->model_count);
+        int ci = c[0] ? resolve_catalog(c, inst->cab_names, inst->cab_paths, inst->cab_count) : -1;
+        int ci2 = c2[0] ? resolve_catalog(c2, inst->cab_names, inst->cab_paths, inst->cab_count) : -1;
+        const char *mpath = mi >= 0 ? inst->model_paths[mi] : m;
+        const char *cpath = ci >= 0 ? inst->cab_paths[ci] : c;
+        const char *cpath2 = ci2 >= 0 ? inst->cab_paths[ci2] : c2;
+
+        if (slot_matches(inst, i, mpath, cpath, cpath2, st->slot_cab_blend[i], &st->slot_eq[i],
+                         st->slot_input_level[i], st->slot_output_level[i],
+                         st->slot_cab_bypass[i])) {
+            if (i == st->slot) want_slot_ready = true;
+        } else {
+            if (i == st->slot) inst->deferred_slot.store(i, std::memory_order_release);
+            load_slot(inst, i, mpath, cpath, cpath2, st->slot_cab_blend[i], &st->slot_eq[i],
+                      st->slot_input_level[i], st->slot_output_level[i],
+                      st->slot_cab_bypass[i]);
         }
+    }
 
-        audio[i] = sum;
-        if (++pos >= hist_len) pos = 0;
+    /* Levels, bypass and CC map - published to the audio thread once */
+    inst->input_level = st->input_level;
+    inst->output_level = st->output_level;
+    inst->cab_bypass = st->cab_bypass;
+    inst->cab_lite = st->cab_lite;
+    set_midi_cc(inst, MIDI_TARGET_INPUT, st->midi_cc_input);
+    set_midi_cc(inst, MIDI_TARGET_OUTPUT, st->midi_cc_output);
+    publish_params(inst);
+
+    /* Active slot: switch now if it was already loaded (otherwise its loader
+     * does it), or go back to the manual rig */
+    if (want_slot_ready) {
+        inst->slot_request.store(st->slot, std::memory_order_release);
+    } else if (st->slot < 0 || st->slot >= MAX_SLOTS || !st->slot_used[st->slot]) {
+        inst->slot_request.store(SLOT_REQ_MANUAL, std::memory_order_release);
     }
 
-    inst->cab_hist_pos = pos;
+    delete st;
+    plugin_log("NAM: state restored");
 }
 
-/* Background model loader thread */
-static void *model_loader_thread(void *arg) {
-    nam_instance_t *inst = (nam_instance_t *)arg;
+/* ======================================================================== */
+/* Parameter table                                                           */
+/* ======================================================================== */
 
-    char msg[MAX_PATH_LEN + 64];
-    snprintf(msg, sizeof(msg), "NAM: loading model %s", inst->model_path);
-    plugin_log(msg);
+/* Every set_param/get_param key is described once here. Lookup goes through
+ * a perfect hash built at compile time, so dispatch costs one hash plus one
+ * strcmp regardless of how many keys exist. To add a parameter: add an id,
+ * add a row to k_params, handle the id in v2_set_param/v2_get_param. */
 
-    NeuralAudio::NeuralModel *new_model =
-        NeuralAudio::NeuralModel::CreateFromFile(inst->model_path);
+typedef enum {
+    PARAM_INPUT_LEVEL,
+    PARAM_OUTPUT_LEVEL,
+    PARAM_MODEL,
+    PARAM_MODEL_NAME,
+    PARAM_MODEL_COUNT,
+    PARAM_MODEL_INDEX,
+    PARAM_MODEL_LIST,
+    PARAM_LOADING,
+    PARAM_CAB_NAME,
+    PARAM_CAB_COUNT,
+    PARAM_CAB_INDEX,
+    PARAM_CAB_BYPASS,
+    PARAM_CAB_LITE,
+    PARAM_CAB_FIT_ERROR,
+    PARAM_CAB_FP16_ERROR,
+    PARAM_CAB_LIST,
+    PARAM_UI_HIERARCHY,
+    PARAM_MIDI_CC_INPUT,
+    PARAM_MIDI_CC_OUTPUT,
+    PARAM_SLOT,
+    PARAM_SLOT_STORE,
+    PARAM_SLOT_CLEAR,
+    PARAM_SLOT_LIST,
+    PARAM_SLOT_LOADING,
+    PARAM_STATE,
+    PARAM_LOADER_POLICY,
+    PARAM_LOADER_CPUS,
+    PARAM_BLOCK_STATS,
+    PARAM_MEMORY_STATS,
+    PARAM_CPU_BUDGET,
+    PARAM_WATCHDOG,
+    PARAM_CAB2_INDEX,
+    PARAM_CAB2_NAME,
+    PARAM_CAB_BLEND,
+    PARAM_EQ_BASS,
+    PARAM_EQ_MID,
+    PARAM_EQ_TREBLE,
+    PARAM_CAB_BANK,
+    PARAM_CONV_BENCH,
+} param_id_t;
 
-    if (new_model) {
-        snprintf(msg, sizeof(msg), "NAM: model loaded successfully (sample_rate=%.0f)",
-                 new_model->GetSampleRate());
-        plugin_log(msg);
-    } else {
-        snprintf(msg, sizeof(msg), "NAM: failed to load model %s", inst->model_path);
-        plugin_log(msg);
-    }
+typedef enum {
+    PTYPE_FLOAT,   /* parsed with atof, clamped to [min, max] */
+    PTYPE_INT,     /* parsed with atoi */
+    PTYPE_BOOL,    /* parsed with atoi, nonzero = true */
+    PTYPE_STRING,  /* passed through raw */
+    PTYPE_JSON,    /* JSON blob */
+} param_type_t;
 
-    inst->pending_model.store(new_model, std::memory_order_release);
-    inst->loading.store(false, std::memory_order_release);
+#define PARAM_SET 0x1
+#define PARAM_GET 0x2
+#define PARAM_RW  (PARAM_SET | PARAM_GET)
 
-    return nullptr;
+typedef struct {
+    const char *key;
+    param_id_t id;
+    param_type_t type;
+    uint8_t access;
+    float min;
+    float max;
+} param_desc_t;
+
+static constexpr param_desc_t k_params[] = {
+    { "input_level",  PARAM_INPUT_LEVEL,  PTYPE_FLOAT,  PARAM_RW,  0.0f, 1.0f },
+    { "output_level", PARAM_OUTPUT_LEVEL, PTYPE_FLOAT,  PARAM_RW,  0.0f, 1.0f },
+    { "model",        PARAM_MODEL,        PTYPE_STRING, PARAM_SET, 0.0f, 0.0f },
+    { "model_name",   PARAM_MODEL_NAME,   PTYPE_STRING, PARAM_GET, 0.0f, 0.0f },
+    { "model_count",  PARAM_MODEL_COUNT,  PTYPE_INT,    PARAM_GET, 0.0f, 0.0f },
+    { "model_index",  PARAM_MODEL_INDEX,  PTYPE_INT,    PARAM_RW,  0.0f, 0.0f },
+    { "model_list",   PARAM_MODEL_LIST,   PTYPE_JSON,   PARAM_GET, 0.0f, 0.0f },
+    { "loading",      PARAM_LOADING,      PTYPE_BOOL,   PARAM_GET, 0.0f, 0.0f },
+    { "cab_name",     PARAM_CAB_NAME,     PTYPE_STRING, PARAM_GET, 0.0f, 0.0f },
+    { "cab_count",    PARAM_CAB_COUNT,    PTYPE_INT,    PARAM_GET, 0.0f, 0.0f },
+    { "cab_index",    PARAM_CAB_INDEX,    PTYPE_INT,    PARAM_RW,  0.0f, 0.0f },
+    { "cab_bypass",   PARAM_CAB_BYPASS,   PTYPE_BOOL,   PARAM_RW,  0.0f, 0.0f },
+    { "cab_lite",     PARAM_CAB_LITE,     PTYPE_BOOL,   PARAM_RW,  0.0f, 0.0f },
+    { "cab_fit_error", PARAM_CAB_FIT_ERROR, PTYPE_FLOAT, PARAM_GET, 0.0f, 0.0f },
+    { "cab_fp16_error", PARAM_CAB_FP16_ERROR, PTYPE_FLOAT, PARAM_GET, 0.0f, 0.0f },
+    { "cab2_index",   PARAM_CAB2_INDEX,   PTYPE_INT,    PARAM_RW,  -1.0f, 0.0f },
+    { "cab2_name",    PARAM_CAB2_NAME,    PTYPE_STRING, PARAM_GET, 0.0f, 0.0f },
+    { "cab_blend",    PARAM_CAB_BLEND,    PTYPE_FLOAT,  PARAM_RW,  0.0f, 1.0f },
+    { "eq_bass",      PARAM_EQ_BASS,      PTYPE_FLOAT,  PARAM_RW,  -EQ_MAX_DB, EQ_MAX_DB },
+    { "eq_mid",       PARAM_EQ_MID,       PTYPE_FLOAT,  PARAM_RW,  -EQ_MAX_DB, EQ_MAX_DB },
+    { "eq_treble",    PARAM_EQ_TREBLE,    PTYPE_FLOAT,  PARAM_RW,  -EQ_MAX_DB, EQ_MAX_DB },
+    { "cab_bank",     PARAM_CAB_BANK,     PTYPE_JSON,   PARAM_GET, 0.0f, 0.0f },
+    { "cab_list",     PARAM_CAB_LIST,     PTYPE_JSON,   PARAM_GET, 0.0f, 0.0f },
+    { "ui_hierarchy", PARAM_UI_HIERARCHY, PTYPE_JSON,   PARAM_GET, 0.0f, 0.0f },
+    { "midi_cc_input",  PARAM_MIDI_CC_INPUT,  PTYPE_INT, PARAM_RW, -1.0f, 127.0f },
+    { "midi_cc_output", PARAM_MIDI_CC_OUTPUT, PTYPE_INT, PARAM_RW, -1.0f, 127.0f },
+    { "slot",         PARAM_SLOT,         PTYPE_INT,    PARAM_RW,  -1.0f, MAX_SLOTS - 1 },
+    { "slot_store",   PARAM_SLOT_STORE,   PTYPE_INT,    PARAM_SET, 0.0f, MAX_SLOTS - 1 },
+    { "slot_clear",   PARAM_SLOT_CLEAR,   PTYPE_INT,    PARAM_SET, 0.0f, MAX_SLOTS - 1 },
+    { "slot_list",    PARAM_SLOT_LIST,    PTYPE_JSON,   PARAM_GET, 0.0f, 0.0f },
+    { "slot_loading", PARAM_SLOT_LOADING, PTYPE_INT,    PARAM_GET, 0.0f, 0.0f },
+    { "state",        PARAM_STATE,        PTYPE_JSON,   PARAM_RW,  0.0f, 0.0f },
+    { "loader_policy", PARAM_LOADER_POLICY, PTYPE_STRING, PARAM_RW, 0.0f, 0.0f },
+    { "loader_cpus",  PARAM_LOADER_CPUS,  PTYPE_STRING, PARAM_RW,  0.0f, 0.0f },
+    { "block_stats",  PARAM_BLOCK_STATS,  PTYPE_JSON,   PARAM_GET, 0.0f, 0.0f },
+    { "memory_stats", PARAM_MEMORY_STATS, PTYPE_JSON,   PARAM_GET, 0.0f, 0.0f },
+    { "cpu_budget",   PARAM_CPU_BUDGET,   PTYPE_JSON,   PARAM_GET, 0.0f, 0.0f },
+    { "watchdog",     PARAM_WATCHDOG,     PTYPE_JSON,   PARAM_GET, 0.0f, 0.0f },
+    { "conv_bench",   PARAM_CONV_BENCH,   PTYPE_JSON,   PARAM_GET, 0.0f, 0.0f },
+};
+
+#define PARAM_COUNT ((int)(sizeof(k_params) / sizeof(k_params[0])))
+#define PARAM_HASH_SIZE 256  /* power of two, comfortably > PARAM_COUNT */
+
+/* Seeded FNV-1a */
+static constexpr uint32_t param_hash(const char *s, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619u;
+    }
+    return h;
 }
 
-static void load_model_async(nam_instance_t *inst, const char *path) {
-    if (inst->loading.load(std::memory_order_acquire)) {
-        plugin_log("NAM: already loading a model, skipping");
-        return;
+/* Search for a seed under which every key lands in its own slot */
+static constexpr uint32_t find_param_seed() {
+    for (uint32_t seed = 1; seed < 100000; seed++) {
+        bool used[PARAM_HASH_SIZE] = {};
+        bool ok = true;
+        for (int i = 0; i < PARAM_COUNT && ok; i++) {
+            uint32_t slot = param_hash(k_params[i].key, seed) & (PARAM_HASH_SIZE - 1);
+            if (used[slot]) ok = false;
+            used[slot] = true;
+        }
+        if (ok) return seed;
     }
+    return 0;
+}
+
+static constexpr uint32_t k_param_seed = find_param_seed();
+static_assert(k_param_seed != 0, "no perfect hash seed for parameter keys");
 
-    strncpy(inst->model_path, path, MAX_PATH_LEN - 1);
-    inst->model_path[MAX_PATH_LEN - 1] = '\0';
-    path_to_name(path, inst->model_name, MAX_NAME_LEN);
+struct param_slots_t { int8_t index[PARAM_HASH_SIZE]; };
+
+static constexpr param_slots_t build_param_slots() {
+    param_slots_t t = {};
+    for (int i = 0; i < PARAM_HASH_SIZE; i++) t.index[i] = -1;
+    for (int i = 0; i < PARAM_COUNT; i++)
+        t.index[param_hash(k_params[i].key, k_param_seed) & (PARAM_HASH_SIZE - 1)] = (int8_t)i;
+    return t;
+}
 
-    inst->loading.store(true, std::memory_order_release);
+static constexpr param_slots_t k_param_slots = build_param_slots();
 
-    pthread_t thread;
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-    pthread_create(&thread, &attr, model_loader_thread, inst);
-    pthread_attr_destroy(&attr);
+/* Returns the descriptor for key, or nullptr if unknown */
+static const param_desc_t *find_param(const char *key) {
+    int idx = k_param_slots.index[param_hash(key, k_param_seed) & (PARAM_HASH_SIZE - 1)];
+    if (idx < 0 || strcmp(k_params[idx].key, key) != 0) return nullptr;
+    return &k_params[idx];
 }
 
 /* ======================================================================== */
@@ -437,52 +3455,158 @@ typedef struct audio_fx_api_v2 {
 typedef audio_fx_api_v2_t* (*audio_fx_init_v2_fn)(const host_api_v1_t *host);
 
 /* --- create_instance --- */
+/* Chain config keys read at creation: loader_policy, loader_cpus, lock_memory */
+static void apply_config(nam_instance_t *inst, const char *config_json) {
+    if (!config_json || !config_json[0]) return;
+    try {
+        nlohmann::json cfg = nlohmann::json::parse(config_json);
+        if (!cfg.is_object()) return;
+        std::string policy = cfg.value("loader_policy", std::string());
+        for (int i = 0; i < (int)(sizeof(k_loader_policy_names) / sizeof(k_loader_policy_names[0])); i++) {
+            if (policy == k_loader_policy_names[i]) inst->loader_policy.store(i);
+        }
+        uint64_t mask;
+        std::string cpus = cfg.value("loader_cpus", std::string("auto"));
+        if (parse_cpu_list(cpus.c_str(), &mask)) inst->loader_cpu_mask.store(mask);
+        std::string lock = cfg.value("lock_memory", std::string("off"));
+        if (lock == "buffers") inst->lock_memory = MEMLOCK_BUFFERS;
+        else if (lock == "all") inst->lock_memory = MEMLOCK_ALL;
+        inst->cab_half = cfg.value("cab_fp16", false);
+        if (inst->cab_half && !HAVE_HALF) {
+            plugin_log("NAM: cab_fp16 needs hardware fp16 conversion, storing cabs in float");
+            inst->cab_half = false;
+        }
+        const double bank_mb = cfg.value("cab_bank_mb", (double)CAB_BANK_DEFAULT_MB);
+        inst->bank_budget = bank_mb > 0.0 ? (size_t)(bank_mb * 1048576.0) : 0;
+    } catch (const nlohmann::json::exception &) {
+        plugin_log("NAM: ignoring malformed config");
+    }
+}
+
 static void* v2_create_instance(const char *module_dir, const char *config_json) {
-    (void)config_json;
     plugin_log("NAM: creating instance");
 
     NeuralAudio::NeuralModel::SetDefaultMaxAudioBufferSize(FRAMES_PER_BLOCK);
+    pthread_once(&g_fft_once, fft_init_tables);
+
+    /* Cache-line aligned, so the shared groups really get their own lines */
+    void *mem = nullptr;
+    if (posix_memalign(&mem, alignof(nam_instance_t), sizeof(nam_instance_t)) != 0) return nullptr;
+    memset(mem, 0, sizeof(nam_instance_t));
+    nam_instance_t *inst = (nam_instance_t *)mem;
+
+    /* Config first: lock_memory decides how DSP buffers are allocated */
+    inst->lock_memory = MEMLOCK_OFF;
+    inst->loader_policy.store(LOADER_POLICY_IDLE);
+    inst->loader_cpu_mask.store(0);
+    inst->bank_budget = (size_t)CAB_BANK_DEFAULT_MB * 1048576;
+    apply_config(inst, config_json);
+    if (inst->lock_memory != MEMLOCK_OFF && mlock(inst, sizeof(nam_instance_t)) != 0) {
+        plugin_log("NAM: mlock failed, instance left unlocked");
+    }
 
-    nam_instance_t *inst = (nam_instance_t *)calloc(1, sizeof(nam_instance_t));
-    if (!inst) return nullptr;
+    /* Hot DSP buffers: one arena, prefaulted (and locked if asked) */
+    inst->arena = alloc_dsp_buffer(ARENA_LEN, inst->lock_memory);
+    if (!inst->arena) {
+        if (inst->lock_memory != MEMLOCK_OFF) munlock(inst, sizeof(nam_instance_t));
+        free(inst);
+        return nullptr;
+    }
+    inst->mono_in = inst->arena + ARENA_MONO_IN;
+    inst->mono_out = inst->arena + ARENA_MONO_OUT;
+    inst->in_gain = inst->arena + ARENA_IN_GAIN;
+    inst->out_gain = inst->arena + ARENA_OUT_GAIN;
+    inst->lite_state = inst->arena + ARENA_LITE;
+    inst->out_r = inst->arena + ARENA_OUT_R;
+    inst->fade_buf = inst->arena + ARENA_FADE;
+    inst->cab_taps = k_budget_ir_taps[0];
+    inst->conv_in = inst->arena + ARENA_CONV_IN;
+    inst->conv_acc = inst->arena + ARENA_CONV_ACC;
+    inst->conv_acc2 = inst->arena + ARENA_CONV_ACC2;
+    inst->conv_out = inst->arena + ARENA_CONV_OUT;
+    inst->cab_history = inst->arena + ARENA_CAB_HIST;
+    inst->fdl = inst->arena + ARENA_FDL;
 
     strncpy(inst->module_dir, module_dir, MAX_PATH_LEN - 1);
     inst->model = nullptr;
-    inst->pending_model.store(nullptr);
-    inst->loading.store(false);
     inst->current_model_index = -1;
 
     /* Cabinet IR defaults */
-    inst->cab_ir = nullptr;
-    inst->cab_ir_len = 0;
-    inst->cab_history = nullptr;
+    inst->cab = nullptr;
+    inst->cab_fit_error.store(-1.0f);
+    inst->cab_half_error.store(0.0f);
     inst->cab_hist_pos = 0;
     inst->cab_bypass = false;
     inst->cab_name[0] = '\0';
     inst->current_cab_index = -1;
+    inst->current_cab2_index = -1;
+    inst->cab_blend = 0.5f;
 
     /* Defaults: input at 0.5 (-6dB), output at 0.5 (-6dB) */
     inst->input_level = 0.5f;
     inst->output_level = 0.5f;
-    inst->input_gain = knob_to_gain(0.5f);
-    inst->output_gain = knob_to_gain(0.5f);
+    inst->params_front.store(0);
+    inst->params_reading.store(-1);
+    publish_params(inst);
+    consume_params(inst);
+    inst->live_serial = inst->live.serial;
+    inst->live_gain_serial = inst->live.gain_serial;
+    inst->cur_input_gain = inst->tgt_input_gain = inst->live.input_gain;
+    inst->cur_output_gain = inst->tgt_output_gain = inst->live.output_gain;
+    inst->cur_cab_bypass = inst->live.cab_bypass;
+
+    /* Rig slots: all empty, playing the manual rig */
+    for (int i = 0; i < MAX_SLOTS; i++) inst->slots[i].store(nullptr);
+    inst->slot_request.store(SLOT_REQ_NONE);
+    inst->active_slot.store(-1);
+    inst->slot_loads.store(0);
+    inst->deferred_slot.store(-1);
+    inst->slot_rig = nullptr;
+    inst->rig_in_use.store(nullptr);
+    inst->fade_rig.store(nullptr);
+    inst->seen_slot = -1;
+    pthread_mutex_init(&inst->publish_lock, nullptr);
+
+    /* Background loading */
+    inst->model_loads.store(0);
+    inst->model_gen.store(0);
+    inst->cab_gen.store(0);
+    inst->pending_update.store(nullptr);
+    inst->retire_head.store(0);
+    inst->retire_tail.store(0);
+    inst->loader_busy.store(0);
+    inst->loader_sched_gen.store(0);
+    inst->audio_cpu.store(-1);
+    start_loader_pool(inst);
+    budget_add(inst);
+
+    /* MIDI CC map: output level on the expression CC, input unmapped */
+    for (int t = 0; t < MIDI_TARGET_COUNT; t++) inst->target_cc[t] = -1;
+    set_midi_cc(inst, MIDI_TARGET_OUTPUT, DEFAULT_OUTPUT_CC);
+    inst->midi_head.store(0);
+    inst->midi_tail.store(0);
+    inst->last_block_ns = 0;
 
     /* Scan for model files */
     scan_models(inst);
 
-    /* Scan for cab IR files */
+    /* Scan for cab IR files, and share or start the bank before anything
+     * can look cabs up in it */
     scan_cabs(inst);
+    start_cab_bank(inst);
 
-    /* Load first model if available */
+    /* Load first model and first cab if available, in parallel */
+    const char *first_model = nullptr;
+    const char *first_cab = nullptr;
     if (inst->model_count > 0) {
         inst->current_model_index = 0;
-        load_model_async(inst, inst->model_paths[0]);
+        first_model = inst->model_paths[0];
     }
-
-    /* Load first cab if available */
     if (inst->cab_count > 0) {
-        load_cab(inst, 0);
+        inst->current_cab_index = 0;
+        first_cab = inst->cab_paths[0];
     }
+    if (first_model || first_cab) request_manual_load(inst, first_model, first_cab);
 
     return inst;
 }
@@ -492,69 +3616,207 @@ static void v2_destroy_instance(void *instance) {
     nam_instance_t *inst = (nam_instance_t *)instance;
     if (!inst) return;
 
-    /* Wait for any pending load */
-    while (inst->loading.load(std::memory_order_acquire)) {
-        struct timespec ts = {0, 10000000}; /* 10ms */
-        nanosleep(&ts, nullptr);
-    }
+    /* Finish any running load, drop queued ones */
+    stop_loader_pool(inst);
+    budget_remove(inst);
 
-    /* Clean up pending model if never consumed */
-    NeuralAudio::NeuralModel *pending = inst->pending_model.load(std::memory_order_acquire);
-    if (pending) delete pending;
+    /* Clean up updates never consumed or not yet reaped */
+    free_update(inst->pending_update.load(std::memory_order_acquire));
+    free_update(inst->fade_update);
+    reap_updates(inst);
 
     if (inst->model) delete inst->model;
 
-    /* Clean up cab IR */
-    free(inst->cab_ir);
-    free(inst->cab_history);
+    /* Clean up rig slots */
+    for (int i = 0; i < MAX_SLOTS; i++) free_rig(inst->slots[i].load(std::memory_order_acquire));
+    for (int i = 0; i < MAX_RETIRED_RIGS; i++) free_rig(inst->retired_rigs[i]);
+    pthread_mutex_destroy(&inst->publish_lock);
 
+    /* Clean up the cab IR, then let go of the bank: nothing here can hold
+     * bank cabs any more */
+    free_cab(inst->cab);
+    release_cab_bank(inst->bank);
+    free_dsp_buffer(inst->arena, ARENA_LEN);
+
+    if (inst->lock_memory != MEMLOCK_OFF) munlock(inst, sizeof(nam_instance_t));
     free(inst);
     plugin_log("NAM: instance destroyed");
 }
 
+/* Add up the audio thread's page faults since the last sample. getrusage
+ * is a syscall, so it only runs every FAULT_SAMPLE_BLOCKS blocks; faults the
+ * host takes on this thread between blocks are counted too. */
+static void sample_faults(nam_instance_t *inst) {
+    struct rusage ru;
+    if (getrusage(RUSAGE_THREAD, &ru) != 0) return;
+    if (inst->fault_base_set) {
+        long minflt = ru.ru_minflt - inst->fault_base[0];
+        long majflt = ru.ru_majflt - inst->fault_base[1];
+        if (minflt > 0) inst->stat_minor_faults.fetch_add((uint32_t)minflt, std::memory_order_relaxed);
+        if (majflt > 0) inst->stat_major_faults.fetch_add((uint32_t)majflt, std::memory_order_relaxed);
+    }
+    inst->fault_base[0] = ru.ru_minflt;
+    inst->fault_base[1] = ru.ru_majflt;
+    inst->fault_base_set = true;
+}
+
+/* Block timing: count blocks that took longer than their real-time
+ * duration, separately for those that overlapped a background load, track
+ * the cost of cab fades, and now and then count page faults and note which
+ * core the audio thread is on so "auto" loader affinity can avoid it. */
+static void account_block(nam_instance_t *inst, uint64_t start_ns, int frames, bool fading) {
+    const uint64_t elapsed = monotonic_ns() - start_ns;
+    const uint64_t deadline = (uint64_t)frames * 1000000000ull / MOVE_SAMPLE_RATE;
+
+    uint32_t blocks = inst->stat_blocks.load(std::memory_order_relaxed) + 1;
+    inst->stat_blocks.store(blocks, std::memory_order_relaxed);
+    budget_account(inst, elapsed, deadline, blocks);
+    if (elapsed <= deadline) inst->wd_misses = 0;
+    if (elapsed > inst->stat_max_block_ns.load(std::memory_order_relaxed)) {
+        inst->stat_max_block_ns.store((uint32_t)std::min<uint64_t>(elapsed, UINT32_MAX),
+                                      std::memory_order_relaxed);
+    }
+    if (fading && elapsed > inst->stat_fade_max_ns.load(std::memory_order_relaxed)) {
+        inst->stat_fade_max_ns.store((uint32_t)std::min<uint64_t>(elapsed, UINT32_MAX),
+                                     std::memory_order_relaxed);
+    }
+    if (elapsed > deadline) {
+        if (++inst->wd_misses >= WATCHDOG_MISSES) watchdog_trip(inst);
+        inst->stat_overruns.fetch_add(1, std::memory_order_relaxed);
+        if (inst->loader_busy.load(std::memory_order_relaxed) > 0) {
+            inst->stat_load_overruns.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if ((blocks % FAULT_SAMPLE_BLOCKS) == 1) sample_faults(inst);
+    if ((blocks % AUDIO_CPU_SAMPLE_BLOCKS) == 1) {
+        int cpu = sched_getcpu();
+        if (cpu >= 0 && cpu != inst->audio_cpu.load(std::memory_order_relaxed)) {
+            inst->audio_cpu.store(cpu, std::memory_order_relaxed);
+            if (inst->loader_cpu_mask.load(std::memory_order_relaxed) == 0) {
+                inst->loader_sched_gen.fetch_add(1, std::memory_order_release);
+            }
+        }
+    }
+}
+
 /* --- process_block --- */
 static void v2_process_block(void *instance, int16_t *audio_inout, int frames) {
     nam_instance_t *inst = (nam_instance_t *)instance;
     if (!inst) return;
+    RT_CHECK_SCOPE();
+    flush_denormals ftz;
+
+    /* Newly loaded model and/or cab (lock-free swap, freed elsewhere) */
+    service_update(inst);
 
-    /* Check for newly loaded model (lock-free swap) */
-    NeuralAudio::NeuralModel *pending = inst->pending_model.load(std::memory_order_acquire);
-    if (pending) {
-        NeuralAudio::NeuralModel *old = inst->model;
-        inst->model = pending;
-        inst->pending_model.store(nullptr, std::memory_order_release);
-        if (old) delete old;
+    /* Pick up this block's parameters. A publish that moved a level knob
+     * replaces the ramp targets; MIDI CCs queued since then override them
+     * in turn. Publishes of anything else leave a CC-set gain alone. */
+    consume_params(inst);
+    if (inst->live.serial != inst->live_serial) {
+        inst->live_serial = inst->live.serial;
+        inst->cur_cab_bypass = inst->live.cab_bypass;
+    }
+    if (inst->live.gain_serial != inst->live_gain_serial) {
+        inst->live_gain_serial = inst->live.gain_serial;
+        inst->tgt_input_gain = inst->live.input_gain;
+        inst->tgt_output_gain = inst->live.output_gain;
     }
 
-    /* No model loaded - pass through */
-    if (!inst->model) return;
+    /* Slot switch (set_param "slot" or Program Change) - pointer swap only */
+    service_slot_request(inst);
+
+    const nam_rig_t *rig = inst->slot_rig;
+    NeuralAudio::NeuralModel *model = rig ? rig->model : inst->model;
+    const nam_cab_t *cab = rig ? rig->cab : inst->cab;
 
     int n = (frames > FRAMES_PER_BLOCK) ? FRAMES_PER_BLOCK : frames;
+    if (n <= 0) return;
+
+    const uint64_t block_start = monotonic_ns();
+    build_gain_curves(inst, n, block_start);
+
+    /* No model loaded - pass through */
+    if (!model) return;
 
     /* Deinterleave stereo int16 -> mono float */
-    float ig = inst->input_gain;
     for (int i = 0; i < n; i++) {
         float l = audio_inout[i * 2]     / 32768.0f;
         float r = audio_inout[i * 2 + 1] / 32768.0f;
-        inst->mono_in[i] = (l + r) * 0.5f * ig;
+        inst->mono_in[i] = (l + r) * 0.5f * inst->in_gain[i];
     }
 
-    /* Process through NAM */
-    inst->model->Process(inst->mono_in, inst->mono_out, (size_t)n);
+    /* Process through NAM, unless the watchdog has taken it out. A block
+     * that makes the miss count reach WATCHDOG_MISSES already falls back
+     * to the dry signal, so the late output never reaches the chain. */
+    const uint64_t deadline = (uint64_t)n * 1000000000ull / MOVE_SAMPLE_RATE;
+    const int safe_mode = inst->safe_mode.load(std::memory_order_relaxed);
+    if (safe_mode == SAFE_OFF) {
+        model->Process(inst->mono_in, inst->mono_out, (size_t)n);
+        if (monotonic_ns() - block_start > deadline && inst->wd_misses + 1 >= WATCHDOG_MISSES) {
+            watchdog_trip(inst);
+        }
+    }
+    if (inst->safe_mode.load(std::memory_order_relaxed) != SAFE_OFF) {
+        memcpy(inst->mono_out, inst->mono_in, (size_t)n * sizeof(float));
+    }
 
-    /* Apply cab IR convolution (if loaded and not bypassed) */
-    if (!inst->cab_bypass && inst->cab_ir) {
-        apply_cab_ir(inst, inst->mono_out, n);
+    /* Apply cab (if loaded and not bypassed): fitted biquads in lite mode,
+     * otherwise the IR convolution, capped by the shared CPU budget. Every
+     * path keeps both convolution histories current. */
+    bool stereo = false;
+    bool lite = false;
+    if (!inst->cur_cab_bypass && cab && inst->safe_mode.load(std::memory_order_relaxed) != SAFE_DRY) {
+        if (n == CONV_BLOCK) conv_push(inst, inst->mono_out);
+        push_cab_history(inst, inst->mono_out, n);
+        lite = inst->live.cab_lite && cab->lite.error_db >= 0.0f;
+        if (lite) {
+            apply_lite_cab(inst, cab, inst->mono_out, n);
+        } else {
+            /* A new budget level's tap cap fades in like a new cab, the
+             * same cab at the old cap playing out; one that arrives during
+             * a fade waits for it to end */
+            const int want_taps = k_budget_ir_taps[g_budget.level.load(std::memory_order_relaxed)];
+            if (want_taps != inst->cab_taps && !inst->fade_cab) {
+                start_cab_fade(inst, cab);
+                inst->cab_taps = want_taps;
+            }
+            const int taps = inst->cab_taps;
+            const float blend = rig ? cab->blend : inst->live.cab_blend;
+            /* A changed cab fades in over the one it replaced, both running
+             * off the input spectra pushed above (as do stereo channels). */
+            const nam_cab_t *old = inst->fade_cab;
+            const float old_blend = old == cab ? blend
+                                  : inst->fade_rig.load(std::memory_order_relaxed) ? old->blend
+                                  : inst->live.cab_blend;
+            const int channels = std::max(cab->channels, old ? old->channels : 1);
+            for (int c = channels - 1; c >= 0; c--) {
+                float *out = c ? inst->out_r : inst->mono_out;
+                if (old) render_cab(inst, old, c, old_blend, inst->fade_taps, n, inst->fade_buf);
+                render_cab(inst, cab, c, blend, taps, n, out);
+                if (old) crossfade_block(inst->fade_buf, out, n, inst->fade_pos);
+            }
+            stereo = channels == 2;
+        }
     }
+    if (!lite) inst->lite_cab = nullptr;
 
     /* Convert back to stereo int16 */
-    float og = inst->output_gain;
+    const float *out_r = stereo ? inst->out_r : inst->mono_out;
     for (int i = 0; i < n; i++) {
-        float s = clampf(inst->mono_out[i] * og, -1.0f, 1.0f);
-        int16_t sample = (int16_t)(s * 32767.0f);
-        audio_inout[i * 2]     = sample;
-        audio_inout[i * 2 + 1] = sample;
+        float l = clampf(inst->mono_out[i] * inst->out_gain[i], -1.0f, 1.0f);
+        float r = clampf(out_r[i] * inst->out_gain[i], -1.0f, 1.0f);
+        audio_inout[i * 2]     = (int16_t)(l * 32767.0f);
+        audio_inout[i * 2 + 1] = (int16_t)(r * 32767.0f);
+    }
+
+    const bool fading = inst->fade_cab != nullptr;
+    if (fading) {
+        inst->fade_pos += n;
+        if (inst->fade_pos >= CAB_FADE_LEN) end_cab_fade(inst);
     }
+    account_block(inst, block_start, n, fading);
 }
 
 /* --- set_param --- */
@@ -562,31 +3824,121 @@ static void v2_set_param(void *instance, const char *key, const char *val) {
     nam_instance_t *inst = (nam_instance_t *)instance;
     if (!inst || !key || !val) return;
 
-    if (strcmp(key, "input_level") == 0) {
-        inst->input_level = clampf(atof(val), 0.0f, 1.0f);
-        inst->input_gain = knob_to_gain(inst->input_level);
-    } else if (strcmp(key, "output_level") == 0) {
-        inst->output_level = clampf(atof(val), 0.0f, 1.0f);
-        inst->output_gain = knob_to_gain(inst->output_level);
-    } else if (strcmp(key, "model_index") == 0) {
-        int idx = atoi(val);
-        if (idx >= 0 && idx < inst->model_count && idx != inst->current_model_index) {
-            inst->current_model_index = idx;
-            load_model_async(inst, inst->model_paths[idx]);
-        }
-    } else if (strcmp(key, "model") == 0) {
+    const param_desc_t *p = find_param(key);
+    if (!p || !(p->access & PARAM_SET)) return;
+
+    sync_control_state(inst);
+
+    /* Parse once according to the descriptor's type */
+    float fval = 0.0f;
+    int ival = 0;
+    if (p->type == PTYPE_FLOAT) fval = clampf(atof(val), p->min, p->max);
+    else if (p->type == PTYPE_INT || p->type == PTYPE_BOOL) ival = atoi(val);
+
+    switch (p->id) {
+    case PARAM_INPUT_LEVEL:
+        inst->input_level = fval;
+        publish_params(inst);
+        break;
+    case PARAM_OUTPUT_LEVEL:
+        inst->output_level = fval;
+        publish_params(inst);
+        break;
+    case PARAM_MODEL_INDEX:
+        if (ival >= 0 && ival < inst->model_count && ival != inst->current_model_index) {
+            inst->current_model_index = ival;
+            request_manual_load(inst, inst->model_paths[ival], nullptr);
+        }
+        inst->slot_request.store(SLOT_REQ_MANUAL, std::memory_order_release);
+        break;
+    case PARAM_MODEL:
         /* Direct path load */
-        load_model_async(inst, val);
-    } else if (strcmp(key, "cab_index") == 0) {
-        int idx = atoi(val);
-        if (idx >= 0 && idx < inst->cab_count && idx != inst->current_cab_index) {
-            load_cab(inst, idx);
-        }
-    } else if (strcmp(key, "cab_bypass") == 0) {
-        inst->cab_bypass = (atoi(val) != 0);
+        request_manual_load(inst, val, nullptr);
+        inst->slot_request.store(SLOT_REQ_MANUAL, std::memory_order_release);
+        break;
+    case PARAM_CAB_INDEX:
+        if (ival >= 0 && ival < inst->cab_count && ival != inst->current_cab_index) {
+            inst->current_cab_index = ival;
+            request_manual_load(inst, nullptr, inst->cab_paths[ival]);
+        }
+        inst->slot_request.store(SLOT_REQ_MANUAL, std::memory_order_release);
+        break;
+    case PARAM_CAB2_INDEX:
+        if (ival >= -1 && ival < inst->cab_count && ival != inst->current_cab2_index) {
+            inst->current_cab2_index = ival;
+            if (inst->current_cab_index >= 0) {
+                request_manual_load(inst, nullptr, current_cab_path(inst));
+            }
+        }
+        inst->slot_request.store(SLOT_REQ_MANUAL, std::memory_order_release);
+        break;
+    case PARAM_CAB_BLEND:
+        /* Plays immediately from both spectra; premixed once it settles */
+        inst->cab_blend = fval;
+        if (inst->current_cab2_index >= 0) schedule_cab_rebuild(inst);
+        publish_params(inst);
+        break;
+    case PARAM_EQ_BASS:
+    case PARAM_EQ_MID:
+    case PARAM_EQ_TREBLE: {
+        /* Baked into the cab IR in the background once the knob settles */
+        float *band = p->id == PARAM_EQ_BASS ? &inst->eq.bass
+                    : p->id == PARAM_EQ_MID ? &inst->eq.mid : &inst->eq.treble;
+        if (*band != fval) {
+            *band = fval;
+            schedule_cab_rebuild(inst);
+        }
+        break;
+    }
+    case PARAM_CAB_LITE:
+        inst->cab_lite = (ival != 0);
+        publish_params(inst);
+        break;
+    case PARAM_CAB_BYPASS: {
+        inst->cab_bypass = (ival != 0);
+        publish_params(inst);
         char msg[64];
         snprintf(msg, sizeof(msg), "NAM: cab bypass %s", inst->cab_bypass ? "on" : "off");
         plugin_log(msg);
+        break;
+    }
+    case PARAM_MIDI_CC_INPUT:
+        set_midi_cc(inst, MIDI_TARGET_INPUT, ival);
+        break;
+    case PARAM_MIDI_CC_OUTPUT:
+        set_midi_cc(inst, MIDI_TARGET_OUTPUT, ival);
+        break;
+    case PARAM_SLOT:
+        /* -1 returns to the manually selected model/cab */
+        if (ival >= -1 && ival < MAX_SLOTS) inst->slot_request.store(ival, std::memory_order_release);
+        break;
+    case PARAM_SLOT_STORE:
+        store_slot(inst, ival);
+        break;
+    case PARAM_SLOT_CLEAR:
+        clear_slot(inst, ival);
+        break;
+    case PARAM_STATE:
+        restore_state(inst, val);
+        break;
+    case PARAM_LOADER_POLICY:
+        for (int i = 0; i < (int)(sizeof(k_loader_policy_names) / sizeof(k_loader_policy_names[0])); i++) {
+            if (strcmp(val, k_loader_policy_names[i]) == 0) {
+                inst->loader_policy.store(i, std::memory_order_release);
+                inst->loader_sched_gen.fetch_add(1, std::memory_order_release);
+            }
+        }
+        break;
+    case PARAM_LOADER_CPUS: {
+        uint64_t mask;
+        if (parse_cpu_list(val, &mask)) {
+            inst->loader_cpu_mask.store(mask, std::memory_order_release);
+            inst->loader_sched_gen.fetch_add(1, std::memory_order_release);
+        }
+        break;
+    }
+    default:
+        break;
     }
 }
 
@@ -595,19 +3947,23 @@ static int v2_get_param(void *instance, const char *key, char *buf, int buf_len)
     nam_instance_t *inst = (nam_instance_t *)instance;
     if (!inst || !key || !buf) return -1;
 
-    if (strcmp(key, "input_level") == 0)
-        return snprintf(buf, buf_len, "%.2f", inst->input_level);
-    if (strcmp(key, "output_level") == 0)
-        return snprintf(buf, buf_len, "%.2f", inst->output_level);
-    if (strcmp(key, "model_name") == 0)
+    const param_desc_t *p = find_param(key);
+    if (!p || !(p->access & PARAM_GET)) return -1;
+
+    switch (p->id) {
+    case PARAM_INPUT_LEVEL:
+        return snprintf(buf, buf_len, "%.2f", shown_levels(inst).input_level);
+    case PARAM_OUTPUT_LEVEL:
+        return snprintf(buf, buf_len, "%.2f", shown_levels(inst).output_level);
+    case PARAM_MODEL_NAME:
         return snprintf(buf, buf_len, "%s", inst->model_name[0] ? inst->model_name : "(none)");
-    if (strcmp(key, "model_count") == 0)
+    case PARAM_MODEL_COUNT:
         return snprintf(buf, buf_len, "%d", inst->model_count);
-    if (strcmp(key, "model_index") == 0)
+    case PARAM_MODEL_INDEX:
         return snprintf(buf, buf_len, "%d", inst->current_model_index);
 
     /* Dynamic model list for Shadow UI browser - rescan each time */
-    if (strcmp(key, "model_list") == 0) {
+    case PARAM_MODEL_LIST: {
         scan_models(inst);
 
         int written = 0;
@@ -621,21 +3977,159 @@ static int v2_get_param(void *instance, const char *key, char *buf, int buf_len)
         return written;
     }
 
-    if (strcmp(key, "loading") == 0)
-        return snprintf(buf, buf_len, "%d", inst->loading.load(std::memory_order_acquire) ? 1 : 0);
+    case PARAM_LOADING:
+        return snprintf(buf, buf_len, "%d", inst->model_loads.load(std::memory_order_acquire) > 0 ? 1 : 0);
 
     /* Cabinet params */
-    if (strcmp(key, "cab_name") == 0)
+    case PARAM_CAB_NAME:
         return snprintf(buf, buf_len, "%s", inst->cab_name[0] ? inst->cab_name : "(none)");
-    if (strcmp(key, "cab_count") == 0)
+    case PARAM_CAB_COUNT:
         return snprintf(buf, buf_len, "%d", inst->cab_count);
-    if (strcmp(key, "cab_index") == 0)
+    case PARAM_CAB_INDEX:
         return snprintf(buf, buf_len, "%d", inst->current_cab_index);
-    if (strcmp(key, "cab_bypass") == 0)
-        return snprintf(buf, buf_len, "%d", inst->cab_bypass ? 1 : 0);
+    case PARAM_CAB_BYPASS:
+        return snprintf(buf, buf_len, "%d", shown_levels(inst).cab_bypass ? 1 : 0);
+    case PARAM_CAB_LITE:
+        return snprintf(buf, buf_len, "%d", inst->cab_lite ? 1 : 0);
+    case PARAM_CAB2_INDEX:
+        return snprintf(buf, buf_len, "%d", inst->current_cab2_index);
+    case PARAM_CAB2_NAME: {
+        int idx = inst->current_cab2_index;
+        return snprintf(buf, buf_len, "%s", (idx >= 0 && idx < inst->cab_count) ? inst->cab_names[idx] : "(none)");
+    }
+    case PARAM_CAB_BLEND:
+        return snprintf(buf, buf_len, "%.3f", inst->cab_blend);
+    case PARAM_EQ_BASS:
+        return snprintf(buf, buf_len, "%.1f", inst->eq.bass);
+    case PARAM_EQ_MID:
+        return snprintf(buf, buf_len, "%.1f", inst->eq.mid);
+    case PARAM_EQ_TREBLE:
+        return snprintf(buf, buf_len, "%.1f", inst->eq.treble);
+    case PARAM_CAB_FIT_ERROR: {
+        /* The playing cab: the active slot's, or the manual one */
+        float err = inst->cab_fit_error.load(std::memory_order_relaxed);
+        int slot = inst->active_slot.load(std::memory_order_acquire);
+        if (slot >= 0) {
+            const nam_rig_t *rig = inst->slots[slot].load(std::memory_order_acquire);
+            err = (rig && rig->cab) ? rig->cab->lite.error_db : -1.0f;
+        }
+        return snprintf(buf, buf_len, "%.2f", err);
+    }
+    case PARAM_CAB_FP16_ERROR: {
+        float err = inst->cab_half_error.load(std::memory_order_relaxed);
+        int slot = inst->active_slot.load(std::memory_order_acquire);
+        if (slot >= 0) {
+            const nam_rig_t *rig = inst->slots[slot].load(std::memory_order_acquire);
+            err = (rig && rig->cab) ? rig->cab->half_error_db : 0.0f;
+        }
+        return snprintf(buf, buf_len, "%.1f", err);
+    }
+
+    /* MIDI CC assignments */
+    case PARAM_MIDI_CC_INPUT:
+        return snprintf(buf, buf_len, "%d", inst->target_cc[MIDI_TARGET_INPUT]);
+    case PARAM_MIDI_CC_OUTPUT:
+        return snprintf(buf, buf_len, "%d", inst->target_cc[MIDI_TARGET_OUTPUT]);
+
+    /* Rig slots */
+    case PARAM_SLOT:
+        return snprintf(buf, buf_len, "%d", inst->active_slot.load(std::memory_order_acquire));
+    case PARAM_SLOT_LOADING:
+        return snprintf(buf, buf_len, "%d", inst->slot_loads.load(std::memory_order_acquire));
+    case PARAM_STATE:
+        return get_state(inst, buf, buf_len);
+
+    /* Loader scheduling and block timing */
+    case PARAM_LOADER_POLICY:
+        return snprintf(buf, buf_len, "%s",
+                        k_loader_policy_names[inst->loader_policy.load(std::memory_order_acquire)]);
+    case PARAM_LOADER_CPUS:
+        return format_cpu_list(inst->loader_cpu_mask.load(std::memory_order_acquire), buf, buf_len);
+    case PARAM_BLOCK_STATS:
+        return snprintf(buf, buf_len,
+            "{\"blocks\":%u,\"overruns\":%u,\"load_overruns\":%u,\"max_block_us\":%.1f,\"audio_cpu\":%d,"
+            "\"cab_fades\":%u,\"fade_max_block_us\":%.1f}",
+            inst->stat_blocks.load(std::memory_order_relaxed),
+            inst->stat_overruns.load(std::memory_order_relaxed),
+            inst->stat_load_overruns.load(std::memory_order_relaxed),
+            inst->stat_max_block_ns.load(std::memory_order_relaxed) / 1000.0,
+            inst->audio_cpu.load(std::memory_order_relaxed),
+            inst->stat_cab_fades.load(std::memory_order_relaxed),
+            inst->stat_fade_max_ns.load(std::memory_order_relaxed) / 1000.0);
+    case PARAM_CONV_BENCH:
+        return format_conv_bench(buf, buf_len);
+    case PARAM_MEMORY_STATS: {
+        static const char *lock_names[] = { "off", "buffers", "all" };
+        return snprintf(buf, buf_len,
+            "{\"lock_memory\":\"%s\",\"locked_bytes\":%ld,\"audio_minor_faults\":%u,\"audio_major_faults\":%u}",
+            lock_names[inst->lock_memory], locked_bytes(),
+            inst->stat_minor_faults.load(std::memory_order_relaxed),
+            inst->stat_major_faults.load(std::memory_order_relaxed));
+    }
+    case PARAM_WATCHDOG: {
+        static const char *mode_names[] = { "off", "cab_only", "dry" };
+        static const char *errors[] = {
+            "",
+            "model too slow for real time, bypassed (cab only)",
+            "too slow for real time, bypassed (dry)",
+        };
+        const int mode = inst->safe_mode.load(std::memory_order_relaxed);
+        return snprintf(buf, buf_len, "{\"safe_mode\":\"%s\",\"trips\":%u,\"error\":\"%s\"}",
+                        mode_names[mode], inst->safe_trips.load(std::memory_order_relaxed), errors[mode]);
+    }
+    case PARAM_CAB_BANK: {
+        cab_bank_t *bank = inst->bank;
+        if (!bank) {
+            return snprintf(buf, buf_len, "{\"cabs\":0,\"catalog\":%d,\"bytes\":0,\"budget\":0,"
+                            "\"loading\":0,\"instances\":0}", inst->cab_count);
+        }
+        pthread_mutex_lock(&bank->lock);
+        const size_t bytes = bank->bytes;
+        pthread_mutex_unlock(&bank->lock);
+        pthread_mutex_lock(&g_banks_lock);
+        const int refs = bank->refs;
+        pthread_mutex_unlock(&g_banks_lock);
+        return snprintf(buf, buf_len, "{\"cabs\":%d,\"catalog\":%d,\"bytes\":%zu,\"budget\":%zu,"
+                        "\"loading\":%d,\"instances\":%d}",
+                        bank->count.load(std::memory_order_relaxed), inst->cab_count,
+                        bytes, bank->budget, bank_pending(bank) ? 1 : 0, refs);
+    }
+    case PARAM_CPU_BUDGET: {
+        const int level = g_budget.level.load(std::memory_order_relaxed);
+        const uint64_t deadline = (uint64_t)FRAMES_PER_BLOCK * 1000000000ull / MOVE_SAMPLE_RATE;
+        const double deadline_ns = (double)deadline;
+        const uint32_t own = inst->budget_share >= 0
+            ? g_budget.shares[inst->budget_share].cost_ns.load(std::memory_order_relaxed) : 0;
+        return snprintf(buf, buf_len,
+            "{\"level\":%d,\"max_ir_taps\":%d,\"load\":%.3f,\"instance_load\":%.3f,\"instances\":%d}",
+            level, k_budget_ir_taps[level],
+            budget_total(monotonic_ns(), deadline) / deadline_ns,
+            own / deadline_ns,
+            g_budget.instances.load(std::memory_order_relaxed));
+    }
+    case PARAM_SLOT_LIST: {
+        int written = 0;
+        written += snprintf(buf + written, buf_len - written, "[");
+        pthread_mutex_lock(&inst->publish_lock);
+        for (int i = 0; i < MAX_SLOTS && written < buf_len - 300; i++) {
+            const nam_rig_t *rig = inst->slots[i].load(std::memory_order_acquire);
+            if (i > 0) written += snprintf(buf + written, buf_len - written, ",");
+            if (rig) {
+                written += snprintf(buf + written, buf_len - written,
+                    "{\"label\":\"%d: %s%s%s\",\"index\":%d}", i + 1, rig->model_name,
+                    rig->cab_name[0] ? " / " : "", rig->cab_name, i);
+            } else {
+                written += snprintf(buf + written, buf_len - written,
+                    "{\"label\":\"%d: (empty)\",\"index\":%d}", i + 1, i);
+            }
+        }
+        pthread_mutex_unlock(&inst->publish_lock);
+        written += snprintf(buf + written, buf_len - written, "]");
+        return written;
+    }
 
     /* Dynamic cab list for Shadow UI browser - rescan each time */
-    if (strcmp(key, "cab_list") == 0) {
+    case PARAM_CAB_LIST: {
         scan_cabs(inst);
 
         int written = 0;
@@ -649,8 +4143,9 @@ static int v2_get_param(void *instance, const char *key, char *buf, int buf_len)
         return written;
     }
 
-    /* ui_hierarchy - returned dynamically so model/cab name is current */
-    if (strcmp(key, "ui_hierarchy") == 0) {
+    /* ui_hierarchy - returned dynamically so model/cab name is current.
+     * Keep the levels in step with the static copy in module.json. */
+    case PARAM_UI_HIERARCHY: {
         const char *hierarchy = "{"
             "\"modes\":null,"
             "\"levels\":{"
@@ -663,7 +4158,11 @@ static int v2_get_param(void *instance, const char *key, char *buf, int buf_len)
                         "{\"key\":\"output_level\",\"label\":\"Output\"},"
                         "{\"key\":\"cab_bypass\",\"label\":\"Cab Bypass\"},"
                         "{\"level\":\"models\",\"label\":\"Choose Model\"},"
-                        "{\"level\":\"cabs\",\"label\":\"Choose Cabinet\"}"
+                        "{\"level\":\"cabs\",\"label\":\"Choose Cabinet\"},"
+                        "{\"level\":\"cab\",\"label\":\"Cab Settings\"},"
+                        "{\"level\":\"eq\",\"label\":\"Cab EQ\"},"
+                        "{\"level\":\"slots\",\"label\":\"Rig Slots\"},"
+                        "{\"level\":\"store\",\"label\":\"Store to Slot\"}"
                     "]"
                 "},"
                 "\"models\":{"
@@ -681,15 +4180,86 @@ static int v2_get_param(void *instance, const char *key, char *buf, int buf_len)
                     "\"children\":null,"
                     "\"knobs\":[],"
                     "\"params\":[]"
+                "},"
+                "\"cab\":{"
+                    "\"label\":\"Cab Settings\","
+                    "\"children\":null,"
+                    "\"knobs\":[\"cab_blend\"],"
+                    "\"params\":["
+                        "{\"key\":\"cab2_index\",\"label\":\"Second Cab\"},"
+                        "{\"key\":\"cab_blend\",\"label\":\"Cab Blend\"},"
+                        "{\"key\":\"cab_lite\",\"label\":\"Lite Cab\"}"
+                    "]"
+                "},"
+                "\"eq\":{"
+                    "\"label\":\"Cab EQ\","
+                    "\"children\":null,"
+                    "\"knobs\":[\"eq_bass\",\"eq_mid\",\"eq_treble\"],"
+                    "\"params\":["
+                        "{\"key\":\"eq_bass\",\"label\":\"Bass\"},"
+                        "{\"key\":\"eq_mid\",\"label\":\"Mid\"},"
+                        "{\"key\":\"eq_treble\",\"label\":\"Treble\"}"
+                    "]"
+                "},"
+                "\"slots\":{"
+                    "\"label\":\"Rig Slot\","
+                    "\"items_param\":\"slot_list\","
+                    "\"select_param\":\"slot\","
+                    "\"children\":null,"
+                    "\"knobs\":[],"
+                    "\"params\":[]"
+                "},"
+                "\"store\":{"
+                    "\"label\":\"Store to Slot\","
+                    "\"items_param\":\"slot_list\","
+                    "\"select_param\":\"slot_store\","
+                    "\"children\":null,"
+                    "\"knobs\":[],"
+                    "\"params\":[]"
                 "}"
             "}"
         "}";
         return snprintf(buf, buf_len, "%s", hierarchy);
     }
 
+    default:
+        break;
+    }
+
     return -1;
 }
 
+/* --- on_midi --- */
+/* Program Change n selects rig slot n. Control changes on a mapped CC are
+ * queued for process_block with their arrival time; everything else is
+ * ignored. Never blocks - if the queue is full (audio thread stalled) the
+ * event is dropped. */
+static void v2_on_midi(void *instance, const uint8_t *msg, int len, int source) {
+    nam_instance_t *inst = (nam_instance_t *)instance;
+    if (!inst || !msg || len < 2) return;
+    if (source == MOVE_MIDI_SOURCE_HOST) return;  /* clock etc. */
+
+    if ((msg[0] & 0xF0) == 0xC0) {
+        int program = msg[1] & 0x7F;
+        if (program < MAX_SLOTS) inst->slot_request.store(program, std::memory_order_release);
+        return;
+    }
+    if (len < 3 || (msg[0] & 0xF0) != 0xB0) return;
+
+    uint8_t target = inst->cc_map[msg[1] & 0x7F].load(std::memory_order_relaxed);
+    if (target == MIDI_TARGET_NONE) return;
+
+    uint32_t head = inst->midi_head.load(std::memory_order_relaxed);
+    uint32_t tail = inst->midi_tail.load(std::memory_order_acquire);
+    if (head - tail >= MIDI_QUEUE_SIZE) return;
+
+    midi_event_t *ev = &inst->midi_queue[head & (MIDI_QUEUE_SIZE - 1)];
+    ev->time_ns = monotonic_ns();
+    ev->target = target;
+    ev->gain = knob_to_gain((msg[2] & 0x7F) / 127.0f);
+    inst->midi_head.store(head + 1, std::memory_order_release);
+}
+
 /* ======================================================================== */
 /* Entry point                                                               */
 /* ======================================================================== */
@@ -706,7 +4276,7 @@ extern "C" audio_fx_api_v2_t* move_audio_fx_init_v2(const host_api_v1_t *host) {
     g_fx_api_v2.process_block   = v2_process_block;
     g_fx_api_v2.set_param       = v2_set_param;
     g_fx_api_v2.get_param       = v2_get_param;
-    g_fx_api_v2.on_midi         = nullptr; /* No MIDI handling needed */
+    g_fx_api_v2.on_midi         = v2_on_midi;
 
     plugin_log("NAM: audio FX plugin initialized (NeuralAudio by Mike Oliphant)");
 